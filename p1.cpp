@@ -1,7 +1,33 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 #include <queue>
 #include <deque>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <algorithm>
 #include <iostream>
 
 /**
@@ -49,10 +75,50 @@ using namespace std;
 // #define WRITEBACK_DEBUG
 // #define COMMIT_DEBUG
 
+#define WATCHDOG_CYCLES 1000   //!< Default cycles without a commit before a run gives up on the machine
+#define CLOCK_CHECK_SECONDS 0.01 //!< Wall clock seconds aimed for between looks at the clock for the time budget
+#define TELEMETRY_CYCLES 4096  //!< Default cycles between telemetry updates
+#define TELEMETRY_MAGIC 0x70315354u //!< Marks a telemetry block as set up
+#define PIPEVIEW_TICKS 1000    //!< Ticks per cycle in a pipeline view export
+#define PIPEVIEW_BUFFER (1 << 20) //!< Bytes of a pipeline view export buffered before they are written out
+#define PIPEVIEW_HISTORY 4096  //!< Commit cycles a pipeline view export remembers, for the instructions fast mode skips
+#define PROFILE_COUNTERS 4     //!< Hardware counters read around each stage function
+#define PROFILE_BUCKETS 40     //!< Power of two buckets in each stage's histogram of ticks per call
+
+#define LOOP_MAX_PERIOD 64 //!< Longest loop body, in instructions, the fast mode looks for
+#define LOOP_MIN_ITERS 3   //!< Back-to-back repetitions needed before a block counts as a loop
+#define LOOP_HISTORY 16    //!< Iteration boundaries remembered per loop when looking for a steady state
+
+#define SPLIT_RING_SLOTS 64 //!< Cycles the front end thread may run ahead of the back end thread
+
+#define PIPE_DEPTH 7               //!< Stages an instruction passes through, F to C
+#define FIRST_COMMIT_CYCLES 5      //!< Fewest cycles from a fetch group's F stamp to its commit
+#define BOUND_MAX_WIDTH 8          //!< Widest machine listed in the bounds report
+
+#define DSE_CHUNK_CYCLES 256  //!< Default cycles a configuration runs between exploration decisions
+#define DSE_MIN_SAMPLES 3     //!< Slices needed before the commit rate is trusted for a verdict
+#define DSE_CONFIDENCE_Z 3.0  //!< Standard errors of margin on the commit rate
+
+#define RESIM_SNAPSHOT_CYCLES 64 //!< Default cycles between baseline snapshots kept for incremental re-simulation
+
 unsigned int ISSUE_WIDTH;           //!< User-configured parameter for machine width
 unsigned int PREG_COUNT;            //!< User-configured parameter for the number of physical registers.
 const unsigned int AREG_COUNT = 32; //!< Constant architectural width
 
+/**
+ * @brief Limits on how far any one machine is simulated. Zero turns a limit off.
+ *
+ */
+typedef struct runBudget_t
+{
+    unsigned int maxCycles;          //!< Last cycle simulated
+    unsigned long long maxCommitted; //!< Committed instructions to stop at
+    double maxSeconds;               //!< Wall clock seconds per machine
+    unsigned int stallCycles;        //!< Cycles without a commit before the watchdog stops the machine
+} runBudget_t;
+
+runBudget_t theBudget = {0, 0, 0.0, WATCHDOG_CYCLES}; //!< User-configured run budget
+
 /**
  * @brief Acts as the instruction memory ROB, and commit controller.
  *
@@ -81,6 +147,10 @@ typedef struct iRecord_t
     unsigned int F, Dc, R, Di, IS, W, C; // Cycle where the thing completed
 } iRecord_t;
 
+unsigned int iRecord_t::*const stageStamps[] = {&iRecord_t::F, &iRecord_t::Dc, &iRecord_t::R, &iRecord_t::Di, &iRecord_t::IS, &iRecord_t::W, &iRecord_t::C}; //!< Cycle stamps in pipeline order
+int iRecord_t::*const archOperands[] = {&iRecord_t::op1, &iRecord_t::op2, &iRecord_t::op3};          //!< Operands as in the trace
+int iRecord_t::*const renamedOperands[] = {&iRecord_t::op1_r, &iRecord_t::op2_r, &iRecord_t::op3_r}; //!< Operands as renamed
+
 /**
  * @brief Stores the location of instructions in the pipeline
  *
@@ -120,48 +190,235 @@ typedef struct iqEntry_t
     unsigned int age; //!< Age of the IQ entry tracked by iqAge global variable
 } iqEntry_t;
 
-iRecord_t instructions[256];      //!< Contains all instructions possible in the processor.
-frontEndPipe_t *thePipelineState; //<! Pipeline information. Record of iRecord_t's
+/**
+ * @brief Why a machine stopped before every instruction committed
+ *
+ */
+typedef enum haltReason_t
+{
+    HALT_NONE,      //!< Still running, or ran to the end
+    HALT_CYCLES,    //!< Reached runBudget_t::maxCycles
+    HALT_COMMITTED, //!< Reached runBudget_t::maxCommitted
+    HALT_CLOCK,     //!< Ran out of runBudget_t::maxSeconds
+    HALT_WATCHDOG   //!< Went runBudget_t::stallCycles without a commit
+} haltReason_t;
+
+const char *haltNames[] = {"finished", "cycle budget", "commit budget", "time budget", "no progress"};
+
+/**
+ * @brief Run statistics published in shared memory for a reader in another process. Fields are only consistent with each
+ * other between two equal even reads of seq.
+ *
+ */
+typedef struct telemetry_t
+{
+    atomic<unsigned int> magic;        //!< TELEMETRY_MAGIC once the block is set up
+    atomic<int> pid;                   //!< Process running the simulation
+    atomic<unsigned int> seq;          //!< Odd while the simulation is updating the block
+    atomic<int> running;               //!< Cleared once the run is over
+    atomic<int> haltReason;            //!< haltReason_t of a run that is over
+    atomic<unsigned int> cycle;        //!< Cycle of the last update
+    atomic<unsigned int> committed;    //!< Committed instructions
+    atomic<unsigned int> ICOUNT;       //!< Instructions in the trace
+    atomic<unsigned int> robOccupancy; //!< Entries in the ROB
+    atomic<unsigned int> iqOccupancy;  //!< Entries in the issue queue
+    atomic<unsigned int> freeRegs;     //!< Registers on the free list
+    atomic<double> ipc;                //!< IPC since the previous update
+    atomic<double> instrsPerSec;       //!< Committed instructions per wall clock second since the previous update
+    atomic<double> seconds;            //!< Wall clock seconds since the run started
+} telemetry_t;
+
+/**
+ * @brief Simulation side of a telemetry block
+ *
+ */
+typedef struct telemetryWriter_t
+{
+    telemetry_t *block;                        //!< Shared block
+    char name[NAME_MAX];                       //!< Shared memory object name
+    unsigned int every;                        //!< Cycles between updates
+    unsigned int lastCycle;                    //!< Cycle of the previous update
+    unsigned int lastCommitted;                //!< Committed instructions at the previous update
+    chrono::steady_clock::time_point lastTime; //!< Time of the previous update
+} telemetryWriter_t;
+
+/**
+ * @brief Streaming pipeline view export of a window of the trace
+ *
+ */
+typedef struct pipeView_t
+{
+    FILE *out;                  //!< Export file
+    unsigned int first;         //!< First instruction exported
+    unsigned int last;          //!< One past the last instruction exported
+    unsigned int period;        //!< Instructions from the start of one sample to the next, 0 to take the whole window
+    unsigned int count;         //!< Instructions taken at the start of each period
+    unsigned int next;          //!< Next instruction to look at
+    unsigned long long written; //!< Instructions exported so far
+    unsigned int seen;          //!< Instructions whose commit cycle has been recorded
+    unsigned int retired[PIPEVIEW_HISTORY]; //!< Commit cycle of the most recent instructions, instruction i at i % PIPEVIEW_HISTORY
+} pipeView_t;
+
+/**
+ * @brief Stage functions the profile tells apart, in the order stepMachine() calls them
+ *
+ */
+typedef enum profileStage_t
+{
+    PROF_COMMIT,
+    PROF_WRITEBACK,
+    PROF_ISSUE,
+    PROF_DISPATCH,
+    PROF_RENAME,
+    PROF_DECODE,
+    PROF_FETCH,
+    PROF_STAGES
+} profileStage_t;
+
+const char *profileStageNames[] = {"commit", "writeback", "issue", "dispatch", "rename", "decode", "fetch"};
+const char *profileCounterNames[] = {"cycles", "instructions", "cache misses", "branch misses"};
+#ifdef __linux__
+const unsigned long long profileEvents[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+                                            PERF_COUNT_HW_BRANCH_MISSES}; //!< perf_event_open() configs of profileCounterNames
+#endif
+
+/**
+ * @brief Where one stage function's time went
+ *
+ */
+typedef struct stageStats_t
+{
+    unsigned long long calls;                    //!< Calls, one per simulated cycle
+    unsigned long long ticks;                    //!< Time stamp counter ticks inside the function
+    unsigned long long hist[PROFILE_BUCKETS];    //!< Calls by ticks, bucket b holds calls under 2^b ticks
+    unsigned long long counts[PROFILE_COUNTERS]; //!< Hardware counts inside the function
+} stageStats_t;
+
+/**
+ * @brief Profile of the simulator's own stage functions
+ *
+ */
+typedef struct stageProfile_t
+{
+    stageStats_t stages[PROF_STAGES];         //!< Statistics of each stage function
+    int fds[PROFILE_COUNTERS];                //!< Counter file descriptors, the first one leads the group
+    int leader;                               //!< Group leader, -1 without counters
+    int counters;                             //!< Counters open, 0 for timing only
+    int error;                                //!< Why the counters could not be opened
+    chrono::steady_clock::time_point started; //!< Wall clock time profiling started
+    unsigned long long startTicks;            //!< Tick counter when profiling started, to convert ticks to time
+} stageProfile_t;
+
+/**
+ * @brief Tick counter and hardware counts at one point in time
+ *
+ */
+typedef struct profileMark_t
+{
+    unsigned long long ticks;                    //!< Time stamp counter
+    unsigned long long counts[PROFILE_COUNTERS]; //!< Counter group values
+} profileMark_t;
+
+/**
+ * @brief Complete state of one simulated machine. Every stage function operates on one of these so that
+ * several machines can live in the process at the same time.
+ *
+ */
+typedef struct machine_t
+{
+    unsigned int issueWidth; //!< Machine width of this machine
+    unsigned int pregCount;  //!< Number of physical registers of this machine
+
+    iRecord_t *instructions; //!< Instruction memory and per-instruction records, ICOUNT deep
+    unsigned int ICOUNT;     //!< Number of instructions in instruction memory
+    frontEndPipe_t *pipe;    //!< Pipeline information. Record of iRecord_t's, issueWidth lanes
+
+    unsigned int *mapTable;         //!< System map table, depth of AREG_COUNT
+    unsigned int *readyTable;       //!< System ready table, size of pregCount elements
+    deque<unsigned int> freeList;   //!< System free list of pReg's
+    deque<ROB_t *> reorderBuff;     //!< System re-order buffer (ROB). Points to current instruction of execution
+    deque<iqEntry_t> issueQueue;    //!< System issue queue. Linked with ROB
+    unsigned long long iqAge;       //!< IQ age tracker
+    deque<iRecord_t *> wBQueue;     //!< Queue between IS and Writeback to handle pulls from the IQ in IS
+    deque<iRecord_t *> commitQueue; //!< Queue between WB and C to prompt commit to look at stuff.
 
-unsigned int *mapTable;       //!< System map table, depth of PREG_COUNT
-unsigned int *readyTable;     //!< System ready table, size of PREG_COUNT elements
-deque<unsigned int> freeList; //!< System free list of pReg's
-deque<ROB_t *> reorderBuff;   //!< System re-order buffer (ROB). Points to current instruction of execution
-deque<iqEntry_t> issueQueue;  //!< System issue queue. Linked with ROB
-unsigned long long iqAge = 0; //!< IQ age tracker
+    unsigned int cycle;          //!< Current cycle of the machine
+    unsigned int completedInsts; //!< Number of completed instructions
+    unsigned int fetchOffset;    //!< Index of the next instruction to fetch
+    unsigned int stall;          //!< Stall signal out of rename
+    bool halted;                 //!< Set once the run gave up on the machine, see haltReason
+    haltReason_t haltReason;     //!< Budget that stopped the machine
+    unsigned int lastProgress;   //!< Last cycle an instruction committed on, for the watchdog
+    unsigned int lastCommitted;  //!< Committed instructions as of lastProgress
+    chrono::steady_clock::time_point started; //!< Wall clock time of the reset, for the time budget
+    chrono::steady_clock::time_point lastClockCheck; //!< Wall clock time of the last look for the time budget
+    unsigned int clockStride;    //!< Cycles between looks at the clock, sized to take about CLOCK_CHECK_SECONDS
+    unsigned int clockCountdown; //!< Cycles left until the next look at the clock
+    telemetryWriter_t *telemetry; //!< Where to publish run statistics, NULL for nowhere
+    pipeView_t *pipeView;         //!< Where to stream stage transitions as instructions commit, NULL for nowhere
+    stageProfile_t *profile;      //!< Where to charge the time of each stage function, NULL to not profile
 
-deque<iRecord_t *> wBQueue; //!< Queue between IS and Writeback to handle pulls from the IQ in IS
+    deque<ROB_t> robPool;      //!< Storage for the entries reorderBuff points to, oldest first
+    iRecord_t *decodeCopies;   //!< Per-lane copies decode() leaves in the Dc stage, issueWidth deep
+    unsigned int instrCapacity; //!< Records allocated in instructions
+    unsigned int pregCapacity;  //!< Entries allocated in readyTable
+    unsigned int widthCapacity; //!< Lanes allocated in pipe and decodeCopies
+} machine_t;
 
-deque<iRecord_t *> commitQueue; //!< Queue between WB and C to prompt commit to look at stuff.
+/**
+ * @brief Instruction memory as read from a trace file
+ *
+ */
+typedef struct trace_t
+{
+    iRecord_t *instrs;       //!< Instructions of the trace, records otherwise zero
+    unsigned int count;      //!< Number of instructions in instrs
+    unsigned int capacity;   //!< Records allocated in instrs
+    unsigned int pregCount;  //!< Physical register count from the trace header
+    unsigned int issueWidth; //!< Issue width from the trace header
+} trace_t;
+
+trace_t theTrace = {NULL, 0, 0, 0, 0}; //!< Trace given on the command line
 
 /**
- * @brief Reads instructions from a file and places into instruction memory.
+ * @brief Reads instructions from a file and places into instruction memory. Reuses the memory of a trace read before.
  *
- * @return int Number of instructions in the sytesm
+ * @param fileName Trace file to read
+ * @param t Trace to fill in
+ * @return int Number of instructions in the sytesm, -1 if the file could not be read
  */
-int initInstructions()
+int loadTrace(const char *fileName, trace_t *t)
 {
     unsigned int instIndex = -1; // Line '-1' is the entry to determine number of pReg's and issue width
     char lineBuff[32];
 
     // Open the file:
-    FILE *instrSet = fopen("test.in", "r");
+    FILE *instrSet = fopen(fileName, "r");
     if (instrSet == NULL)
     {
         perror("Error reading file\n");
-        return 100;
+        return -1;
     }
+    t->pregCount = t->issueWidth = 0;
     while (fgets(lineBuff, sizeof(lineBuff), instrSet))
     {
         if (instIndex == -1)
         {
-            sscanf(lineBuff, "%u, %u", &PREG_COUNT, &ISSUE_WIDTH);
+            sscanf(lineBuff, "%u, %u", &t->pregCount, &t->issueWidth);
 #ifdef DEBUG_MODE
-            printf("Detected physical register count of %u, Issue width of %u\n", PREG_COUNT, ISSUE_WIDTH);
+            printf("Detected physical register count of %u, Issue width of %u\n", t->pregCount, t->issueWidth);
 #endif
         }
         else
-            sscanf(lineBuff, "%c,%d,%d,%d", &instructions[instIndex].iType, &instructions[instIndex].op1, &instructions[instIndex].op2, &instructions[instIndex].op3);
+        {
+            if (instIndex == t->capacity) // Instruction memory grows by doubling
+            {
+                t->capacity = max(256u, 2 * t->capacity);
+                t->instrs = (iRecord_t *)realloc(t->instrs, t->capacity * sizeof(iRecord_t));
+            }
+            memset(&t->instrs[instIndex], 0, sizeof(iRecord_t));
+            sscanf(lineBuff, "%c,%d,%d,%d", &t->instrs[instIndex].iType, &t->instrs[instIndex].op1, &t->instrs[instIndex].op2, &t->instrs[instIndex].op3);
+        }
         instIndex++;
     }
 
@@ -170,32 +427,50 @@ int initInstructions()
 #endif
     fclose(instrSet);
 
-    return instIndex;
+    t->count = instIndex == -1 ? 0 : instIndex;
+    return t->count;
+}
+
+/**
+ * @brief Releases the memory of a trace
+ *
+ * @param t Trace to release
+ */
+void freeTrace(trace_t *t)
+{
+    free(t->instrs);
+    t->instrs = NULL;
+    t->count = t->capacity = 0;
 }
 
 /**
  * @brief Print records from the commit buffer
  *
- * @param pipe
- * @param numInstr
+ * @param m Machine whose records are printed
+ * @param fileName File to write the records to
  */
-void printRecords(unsigned int numInstr)
+void printRecords(const machine_t *m, const char *fileName)
 {
-    FILE *outputFile = fopen("out.txt", "w");
+    FILE *outputFile = fopen(fileName, "w");
+    if (outputFile == NULL)
+    {
+        perror("Error writing file\n");
+        return;
+    }
 
 #ifdef DEBUG_MODE
     printf("idx: F, Dc, R, Di, IS, WB, C\n");
 #endif
-    for (int i = 0; i < numInstr; i++)
+    for (int i = 0; i < m->ICOUNT; i++)
     {
 #ifdef DEBUG_MODE
-        printf("%d: %d, %d, %d, %d, %d, %d, %d\n", i, instructions[i].F, instructions[i].Dc, instructions[i].R, instructions[i].Di, instructions[i].IS, instructions[i].W, instructions[i].C);
+        printf("%d: %d, %d, %d, %d, %d, %d, %d\n", i, m->instructions[i].F, m->instructions[i].Dc, m->instructions[i].R, m->instructions[i].Di, m->instructions[i].IS, m->instructions[i].W, m->instructions[i].C);
 #endif
-        if (ISSUE_WIDTH < 1 || PREG_COUNT < AREG_COUNT) // If resources are not available, do not make output file
+        if (m->issueWidth < 1 || m->pregCount < AREG_COUNT) // If resources are not available, do not make output file
             break;
         else
         {
-            fprintf(outputFile, "%d, %d, %d, %d, %d, %d, %d\n", instructions[i].F, instructions[i].Dc, instructions[i].R, instructions[i].Di, instructions[i].IS, instructions[i].W, instructions[i].C);
+            fprintf(outputFile, "%d, %d, %d, %d, %d, %d, %d\n", m->instructions[i].F, m->instructions[i].Dc, m->instructions[i].R, m->instructions[i].Di, m->instructions[i].IS, m->instructions[i].W, m->instructions[i].C);
         }
     }
 
@@ -205,23 +480,24 @@ void printRecords(unsigned int numInstr)
 /**
  * @brief Commits instructions IN ORDER by examining the head of the ROB
  *
- * @param pipe Pipeline state of the machine
+ * @param m Machine being simulated
  * @param committedInsts Current number of committed instructions
  * @param cycle Current cycle of the machine
  * @return unsigned int New number of committed instructions
  */
-unsigned int commit(frontEndPipe_t *pipe, unsigned int committedInsts, unsigned int cycle)
+unsigned int commit(machine_t *m, unsigned int committedInsts, unsigned int cycle)
 {
+    frontEndPipe_t *pipe = m->pipe; //!< Lanes of the in-order pipeline
     int commitPull = 0;
 #ifdef COMMIT_DEBUG
     printf("-- commit --\n");
-    if (!reorderBuff.empty())
+    if (!m->reorderBuff.empty())
     {
-        printf("ROB HEAD %d, depth=%lu\n", reorderBuff.front()->instr->op1_r, reorderBuff.size());
-        printf("Commit Q size: %lu\n", commitQueue.size());
+        printf("ROB HEAD %d, depth=%lu\n", m->reorderBuff.front()->instr->op1_r, m->reorderBuff.size());
+        printf("Commit Q size: %lu\n", m->commitQueue.size());
     }
 
-    for (const ROB_t *robEntry : reorderBuff)
+    for (const ROB_t *robEntry : m->reorderBuff)
     {
         if (robEntry->ready == true)
         {
@@ -229,17 +505,17 @@ unsigned int commit(frontEndPipe_t *pipe, unsigned int committedInsts, unsigned
         }
     }
 #endif
-    for (int i = 0; i < ISSUE_WIDTH; i++)
+    for (int i = 0; i < m->issueWidth; i++)
     {
         // Look at head of ROB and see if it can be committed:
-        if (!reorderBuff.empty() && reorderBuff.front()->ready == true && commitPull < ISSUE_WIDTH)
+        if (!m->reorderBuff.empty() && m->reorderBuff.front()->ready == true && commitPull < m->issueWidth)
         {
 #ifdef COMMIT_DEBUG
-            printf("ROB %d ready=%d\n", reorderBuff.front()->instr->op1_r, reorderBuff.front()->ready);
+            printf("ROB %d ready=%d\n", m->reorderBuff.front()->instr->op1_r, m->reorderBuff.front()->ready);
             printf("COMMIT PULL %d\n", commitPull);
 #endif
             // Pull from front of commit queue
-            pipe[commitPull].C = reorderBuff.front()->instr;
+            pipe[commitPull].C = m->reorderBuff.front()->instr;
             pipe[commitPull].C->C = cycle;
             // #ifdef COMMIT_DEBUG
             //             printf("Committed on %d cycle %d\n", commitQueue.front()->op1_r, pipe[commitPull].C->C);
@@ -247,22 +523,22 @@ unsigned int commit(frontEndPipe_t *pipe, unsigned int committedInsts, unsigned
             //             commitQueue.pop_front();
 
 #ifdef COMMIT_DEBUG
-            printf("poping %d from ROB\n", reorderBuff.front()->instr->op1_r);
-            printf("commit queue depth: %lu\n", commitQueue.size());
+            printf("poping %d from ROB\n", m->reorderBuff.front()->instr->op1_r);
+            printf("commit queue depth: %lu\n", m->commitQueue.size());
 #endif
 
-            freeList.push_back(reorderBuff.front()->instr->op1_r); // Reclaim register on the free list
+            m->freeList.push_back(m->reorderBuff.front()->instr->op1_r); // Reclaim register on the free list
             // readyTable[reorderBuff.front().instr.op1_r] = false;
 
-            reorderBuff.pop_front(); // May clear it out, need to be careful here
+            m->reorderBuff.pop_front(); // May clear it out, need to be careful here
 #ifdef COMMIT_DEBUG
-            if (!reorderBuff.empty())
+            if (!m->reorderBuff.empty())
             {
 
                 // reorderBuff.front().instr.op1_r = 111;
-                printf("popped front. ROB depth %lu\n", reorderBuff.size());
-                printf("new ROB FRONT: %d\n", reorderBuff.front()->instr->op1_r);
-                for (const ROB_t *robEntry : reorderBuff)
+                printf("popped front. ROB depth %lu\n", m->reorderBuff.size());
+                printf("new ROB FRONT: %d\n", m->reorderBuff.front()->instr->op1_r);
+                for (const ROB_t *robEntry : m->reorderBuff)
                 {
                     if (robEntry->ready == true)
                         cout << "AFTER pop_front() reorderBuff: " << robEntry->instr->op1_r << endl;
@@ -270,13 +546,13 @@ unsigned int commit(frontEndPipe_t *pipe, unsigned int committedInsts, unsigned
             }
             else
             {
-                printf("ROB is empty. depth %lu", reorderBuff.size());
+                printf("ROB is empty. depth %lu", m->reorderBuff.size());
             }
 #endif
 
             committedInsts++;
 #ifdef COMMIT_DEBUG
-            for (const ROB_t *robEntry : reorderBuff)
+            for (const ROB_t *robEntry : m->reorderBuff)
             {
                 if (robEntry->ready)
                 {
@@ -287,62 +563,67 @@ unsigned int commit(frontEndPipe_t *pipe, unsigned int committedInsts, unsigned
             commitPull++;
         }
 #ifdef COMMIT_DEBUG
-        else if (!reorderBuff.empty())
+        else if (!m->reorderBuff.empty())
         {
-            printf("reg not ready ROB %d ready=%d\n", reorderBuff.front()->instr->op1_r, reorderBuff.front()->ready);
+            printf("reg not ready ROB %d ready=%d\n", m->reorderBuff.front()->instr->op1_r, m->reorderBuff.front()->ready);
         }
 #endif
     }
 
+    // Release the pool entries older than the ROB head:
+    while (!m->robPool.empty() && (m->reorderBuff.empty() || &m->robPool.front() != m->reorderBuff.front()))
+        m->robPool.pop_front();
+
     return committedInsts;
 }
 
 /**
  * @brief Pulls instructions, if available, from the WB queue and marks them ready for completion
  *
- * @param pipe
+ * @param m Machine being simulated
  * @param cycle
  */
-void writeback(frontEndPipe_t *pipe, unsigned int cycle)
+void writeback(machine_t *m, unsigned int cycle)
 {
+    frontEndPipe_t *pipe = m->pipe; //!< Lanes of the in-order pipeline
     iRecord_t *tempRec;
 #ifdef WRITEBACK_DEBUG
     printf("-- writeback --\n");
 
-    for (int i = 0; i < wBQueue.size(); i++)
+    for (int i = 0; i < m->wBQueue.size(); i++)
     {
-        printf("%c dest %d", wBQueue[i]->iType, wBQueue[i]->op1_r);
+        printf("%c dest %d", m->wBQueue[i]->iType, m->wBQueue[i]->op1_r);
     }
 #endif
-    for (int i = 0; i < ISSUE_WIDTH; i++)
+    for (int i = 0; i < m->issueWidth; i++)
     {
-        if (wBQueue.empty() == false)
+        if (m->wBQueue.empty() == false)
         {
             // Pull element from front of wbQueue
-            tempRec = wBQueue.front();
+            tempRec = m->wBQueue.front();
             tempRec->W = cycle;  // Mark completion time
-            wBQueue.pop_front(); // Remove entry from deque
+            m->wBQueue.pop_front(); // Remove entry from deque
 #ifdef WRITEBACK_DEBUG
             printf("Popped %c dest %d from wbQueue\n", tempRec->iType, tempRec->op1_r);
 #endif
 
             // Send instruction to commit:
-            commitQueue.push_back(tempRec);
+            m->commitQueue.push_back(tempRec);
 
             // Search through ROB for destreg to mark as complete. Only mark one entry as complete.
-            if (reorderBuff.empty() == false)
+            if (m->reorderBuff.empty() == false)
             {
-                for (int j = 0; j < reorderBuff.size(); j++)
+                for (int j = 0; j < m->reorderBuff.size(); j++)
                 {
-                    if (reorderBuff.at(j)->instr->op1_r == tempRec->op1_r)
+                    if (m->reorderBuff.at(j)->instr->op1_r == tempRec->op1_r)
                     {
                         // Mark instruction as complete
-                        reorderBuff.at(j)->ready = true;
+                        m->reorderBuff.at(j)->ready = true;
 
                         // Update the ready table for the destination register
-                        readyTable[tempRec->op1_r] = true;
+                        m->readyTable[tempRec->op1_r] = true;
 #ifdef WRITEBACK_DEBUG
-                        printf("Marked ROB[%d]: %c dest %d as complete.\n", j, reorderBuff.at(j)->instr->iType, reorderBuff.at(j)->instr->op1_r);
+                        printf("Marked ROB[%d]: %c dest %d as complete.\n", j, m->reorderBuff.at(j)->instr->iType, m->reorderBuff.at(j)->instr->op1_r);
 #endif
                         // break;
                     }
@@ -356,11 +637,11 @@ void writeback(frontEndPipe_t *pipe, unsigned int cycle)
     }
 #ifdef WRITEBACK_DEBUG
 
-    if (!commitQueue.empty())
+    if (!m->commitQueue.empty())
     {
-        for (int i = 0; i < commitQueue.size(); i++)
+        for (int i = 0; i < m->commitQueue.size(); i++)
         {
-            printf("%c %d\n", commitQueue[i]->iType, commitQueue[i]->op1_r);
+            printf("%c %d\n", m->commitQueue[i]->iType, m->commitQueue[i]->op1_r);
         }
     }
 #endif
@@ -369,44 +650,44 @@ void writeback(frontEndPipe_t *pipe, unsigned int cycle)
 /**
  * @brief Receives instructions from the IQ. Examines them and submits for execution. Wakes up dependent older instructions in the IQ
  *
- * @param pipe Pipeline state of the machine
+ * @param m Machine being simulated
  * @param cycle Current cycle of the machine
  */
-void issue(frontEndPipe_t *pipe, unsigned int cycle)
+void issue(machine_t *m, unsigned int cycle)
 {
 #ifdef ISSUE_DEBUG
     printf("-- issue -- \n");
 #endif
 
-    unsigned int IQpull = 0;     // Number of total pulls from the IQ. IQpull < ISSUE_WIDTH.
+    unsigned int IQpull = 0;     // Number of total pulls from the IQ. IQpull < m->issueWidth.
     deque<unsigned int> wakeupQ; //!< List of elements to search in the IQ for wakeup
 
-    for (int i = 0; i < ISSUE_WIDTH; i++)
+    for (int i = 0; i < m->issueWidth; i++)
     {
-        if (!issueQueue.empty())
+        if (!m->issueQueue.empty())
         {
             int j = 0; // Start with the first element in the issue queue
 
-            while (j < issueQueue.size() && IQpull < ISSUE_WIDTH)
+            while (j < m->issueQueue.size() && IQpull < m->issueWidth)
             {
 #ifdef ISSUE_DEBUG
                 printf("check IQ[%d]:\n", j);
 #endif
-                if (issueQueue[j].src1_ready && issueQueue[j].src2_ready)
+                if (m->issueQueue[j].src1_ready && m->issueQueue[j].src2_ready)
                 {
 #ifdef ISSUE_DEBUG
                     printf("PULL %d: Send IQ entry %d to writeback\n", IQpull, j);
-                    printf("Send itype %c dest %d to WB in IW %d\n", issueQueue[j].instr->iType, issueQueue[j].instr->op1_r, i);
+                    printf("Send itype %c dest %d to WB in IW %d\n", m->issueQueue[j].instr->iType, m->issueQueue[j].instr->op1_r, i);
                     printf("IS cycle %d\n", cycle);
 #endif
-                    issueQueue[j].instr->IS = cycle; // Mark cycle of completion
-                    wBQueue.push_back(issueQueue[j].instr);
+                    m->issueQueue[j].instr->IS = cycle; // Mark cycle of completion
+                    m->wBQueue.push_back(m->issueQueue[j].instr);
 
                     // Add wakeup elements to the local deque of wakeup registers:
-                    wakeupQ.push_back(issueQueue[j].instr->op1_r);
-                    wakeupQ.push_back(issueQueue[j].instr->op2_r);
+                    wakeupQ.push_back(m->issueQueue[j].instr->op1_r);
+                    wakeupQ.push_back(m->issueQueue[j].instr->op2_r);
 
-                    issueQueue.erase(issueQueue.begin() + j);
+                    m->issueQueue.erase(m->issueQueue.begin() + j);
                     IQpull++;
                 }
                 else
@@ -428,21 +709,21 @@ void issue(frontEndPipe_t *pipe, unsigned int cycle)
     // Wakeup dependent instructions by finding their entries in the IQ:
     for (int i = 0; i < wakeupQ.size(); i++)
     {
-        for (int j = 0; j < issueQueue.size(); j++) // Fixed the loop counter from 'i' to 'j'
+        for (int j = 0; j < m->issueQueue.size(); j++) // Fixed the loop counter from 'i' to 'j'
         {
-            if (issueQueue[j].instr->op2_r == wakeupQ[i])
+            if (m->issueQueue[j].instr->op2_r == wakeupQ[i])
             {
 #ifdef ISSUE_DEBUG
-                printf("Woke up register src1 (p%d)\n", issueQueue[j].instr->op2_r);
+                printf("Woke up register src1 (p%d)\n", m->issueQueue[j].instr->op2_r);
 #endif
-                issueQueue[j].src1_ready = true;
+                m->issueQueue[j].src1_ready = true;
             }
-            if (issueQueue[j].instr->op3_r == wakeupQ[i])
+            if (m->issueQueue[j].instr->op3_r == wakeupQ[i])
             {
 #ifdef ISSUE_DEBUG
-                printf("Woke up register src2 (p%d)\n", issueQueue[j].instr->op3_r);
+                printf("Woke up register src2 (p%d)\n", m->issueQueue[j].instr->op3_r);
 #endif
-                issueQueue[j].src2_ready = true;
+                m->issueQueue[j].src2_ready = true;
             }
         }
     }
@@ -456,18 +737,20 @@ void issue(frontEndPipe_t *pipe, unsigned int cycle)
 /**
  * @brief Dispatches instructions into the issue queue
  *
- * @param pipe Current state of the machine
+ * @param m Machine being simulated
  * @param cycle Current cycle of the machine
  */
-void dispatch(frontEndPipe_t *pipe, unsigned int cycle)
+void dispatch(machine_t *m, unsigned int cycle)
 {
+    frontEndPipe_t *pipe = m->pipe; //!< Lanes of the in-order pipeline
 #ifdef DISPATCH_DEBUG
     printf("-- dispatch --\n");
 #endif
-    iqEntry_t *slotEntry = (iqEntry_t *)malloc(sizeof(iqEntry_t)); //!< Slot to place into the issue queue
-    ROB_t *ROBentry = (ROB_t *)malloc(sizeof(ROB_t));              //!< Slot to place into the FIFO ROB
+    iqEntry_t slotBuff;              //!< Storage for the slot, copied into the issue queue
+    iqEntry_t *slotEntry = &slotBuff; //!< Slot to place into the issue queue
+    ROB_t *ROBentry = NULL;           //!< Slot to place into the FIFO ROB, taken from the pool by the first lane that dispatches
 
-    for (int i = 0; i < ISSUE_WIDTH; i++)
+    for (int i = 0; i < m->issueWidth; i++)
     {
         // Pipeline has already been advanced. data in Di is valid to use to generate IQ entry.
 
@@ -484,19 +767,19 @@ void dispatch(frontEndPipe_t *pipe, unsigned int cycle)
             switch (pipe[i].Di->iType)
             {
             case 'R': // op1 produces, all others from table
-                slotEntry->src1_ready = readyTable[pipe[i].Di->op2_r];
-                slotEntry->src2_ready = readyTable[pipe[i].Di->op3_r];
-                readyTable[pipe[i].Di->op1_r] = false;
+                slotEntry->src1_ready = m->readyTable[pipe[i].Di->op2_r];
+                slotEntry->src2_ready = m->readyTable[pipe[i].Di->op3_r];
+                m->readyTable[pipe[i].Di->op1_r] = false;
                 break;
             case 'I': // op1 produces, op2 is dynamic, op3 is immediate.
-                slotEntry->src1_ready = readyTable[pipe[i].Di->op2_r];
+                slotEntry->src1_ready = m->readyTable[pipe[i].Di->op2_r];
                 slotEntry->src2_ready = true;          // op3 is immediate and therefore always ready.
-                readyTable[pipe[i].Di->op1_r] = false; // op1 producer marked false
+                m->readyTable[pipe[i].Di->op1_r] = false; // op1 producer marked false
                 break;
             case 'L':                         // op1 produces, op2 is immediate, op3 is dynamic
                 slotEntry->src1_ready = true; // op2 is immediate and therefore always ready.
-                slotEntry->src2_ready = readyTable[pipe[i].Di->op3_r];
-                readyTable[pipe[i].Di->op1_r] = false; // op1 producer marked false
+                slotEntry->src2_ready = m->readyTable[pipe[i].Di->op3_r];
+                m->readyTable[pipe[i].Di->op1_r] = false; // op1 producer marked false
                 break;
             case 'S': // Consumer only. All values ready to issue.
                 slotEntry->src1_ready = true;
@@ -512,23 +795,28 @@ void dispatch(frontEndPipe_t *pipe, unsigned int cycle)
             // Idiot check to always mark register 0 as ready:
             if (pipe[i].Di->op1_r == 0)
             {
-                readyTable[pipe[i].Di->op1_r] = 0;
+                m->readyTable[pipe[i].Di->op1_r] = 0;
             }
-            slotEntry->age = iqAge;
-            iqAge++;
+            slotEntry->age = m->iqAge;
+            m->iqAge++;
 
             // Generate ROB entry:
+            if (ROBentry == NULL)
+            {
+                m->robPool.push_back(ROB_t());
+                ROBentry = &m->robPool.back();
+            }
             ROBentry->instr = slotEntry->instr;
             ROBentry->committed = false;
             ROBentry->ready = false;
 
             // Send to the IQ and ROB:
-            issueQueue.push_back(*(slotEntry));
-            reorderBuff.push_back(ROBentry);
+            m->issueQueue.push_back(*(slotEntry));
+            m->reorderBuff.push_back(ROBentry);
 #ifdef DISPATCH_DEBUG
-            printf("dispatch pushed %d to ROB, size now %lu. IQ size now %lu. Completed on cycle %d\n", reorderBuff.back()->instr->op1_r, reorderBuff.size(), issueQueue.size(), pipe[i].Di->Di);
+            printf("dispatch pushed %d to ROB, size now %lu. IQ size now %lu. Completed on cycle %d\n", m->reorderBuff.back()->instr->op1_r, m->reorderBuff.size(), m->issueQueue.size(), pipe[i].Di->Di);
 
-            printf("target register for ROB is %d\n", reorderBuff.back()->instr->op1_r);
+            printf("target register for ROB is %d\n", m->reorderBuff.back()->instr->op1_r);
 #endif
         }
         else
@@ -543,12 +831,13 @@ void dispatch(frontEndPipe_t *pipe, unsigned int cycle)
 #endif
 }
 // All loads wait until all older stores. Additional resource for what a load needs to leave the IQ
-unsigned int rename(frontEndPipe_t *pipe, unsigned int cycle)
+unsigned int rename(machine_t *m, unsigned int cycle)
 {
-    // iRecord_t *batch = (iRecord_t *)calloc(ISSUE_WIDTH, sizeof(iRecord_t));
+    frontEndPipe_t *pipe = m->pipe; //!< Lanes of the in-order pipeline
+    // iRecord_t *batch = (iRecord_t *)calloc(issueWidth, sizeof(iRecord_t));
     unsigned int renameStall = false;
     // Rename (map) the architectural registers to their avaialble physical registers:
-    for (int i = 0; i < ISSUE_WIDTH; i++)
+    for (int i = 0; i < m->issueWidth; i++)
     {
         pipe[i].Di = pipe[i].R; // Advance pipeline, containing renamed registers, to dispatch
         if (pipe[i].R != NOP)
@@ -559,7 +848,7 @@ unsigned int rename(frontEndPipe_t *pipe, unsigned int cycle)
 #endif
             pipe[i].R->R = cycle; // Mark cycle of completion.
 
-            if (!freeList.empty())
+            if (!m->freeList.empty())
             {
                 // Examine instruction type to determine how many things need renamed:
                 switch (pipe[i].R->iType)
@@ -569,14 +858,14 @@ unsigned int rename(frontEndPipe_t *pipe, unsigned int cycle)
                     printf("R-type rename\n");
 #endif
                     // Get op2 op3 from map table:
-                    pipe[i].R->op2_r = mapTable[pipe[i].R->op2];
-                    pipe[i].R->op3_r = mapTable[pipe[i].R->op3];
+                    pipe[i].R->op2_r = m->mapTable[pipe[i].R->op2];
+                    pipe[i].R->op3_r = m->mapTable[pipe[i].R->op3];
                     if (pipe[i].R->op1 != 0)
                     {
-                        pipe[i].R->op1_r = freeList.front();         // Assign producer from freelist
-                        freeList.pop_front();                        // Remove from free list
-                        readyTable[pipe[i].R->op1_r] = false;        // Mark not ready
-                        mapTable[pipe[i].R->op1] = pipe[i].R->op1_r; // Update map table value
+                        pipe[i].R->op1_r = m->freeList.front();         // Assign producer from freelist
+                        m->freeList.pop_front();                        // Remove from free list
+                        m->readyTable[pipe[i].R->op1_r] = false;        // Mark not ready
+                        m->mapTable[pipe[i].R->op1] = pipe[i].R->op1_r; // Update map table value
                     }
 
                     break;
@@ -584,12 +873,12 @@ unsigned int rename(frontEndPipe_t *pipe, unsigned int cycle)
 #ifdef RENAME_DEBUG
                     printf("I-type rename\n");
 #endif
-                    pipe[i].R->op1_r = freeList.front();         // Assign producer from freelist
-                    freeList.pop_front();                        // Remove from free list
-                    readyTable[pipe[i].R->op1_r] = false;        // Mark not ready
-                    mapTable[pipe[i].R->op1] = pipe[i].R->op1_r; // Update map table value
+                    pipe[i].R->op1_r = m->freeList.front();         // Assign producer from freelist
+                    m->freeList.pop_front();                        // Remove from free list
+                    m->readyTable[pipe[i].R->op1_r] = false;        // Mark not ready
+                    m->mapTable[pipe[i].R->op1] = pipe[i].R->op1_r; // Update map table value
 
-                    pipe[i].R->op2_r = mapTable[pipe[i].R->op2]; // Get op2 from map table:
+                    pipe[i].R->op2_r = m->mapTable[pipe[i].R->op2]; // Get op2 from map table:
 
                     pipe[i].R->op3_r = pipe[i].R->op3; // op3 is passed directly
                     break;
@@ -600,16 +889,16 @@ unsigned int rename(frontEndPipe_t *pipe, unsigned int cycle)
 #endif
                     if (pipe[i].R->op1 != 0)
                     {
-                        pipe[i].R->op1_r = freeList.front(); // Assign producer from freelist
-                        freeList.pop_front();                // Remove from free list
+                        pipe[i].R->op1_r = m->freeList.front(); // Assign producer from freelist
+                        m->freeList.pop_front();                // Remove from free list
 
-                        readyTable[pipe[i].R->op1_r] = false;        // Mark not ready
-                        mapTable[pipe[i].R->op1] = pipe[i].R->op1_r; // Update map table value
+                        m->readyTable[pipe[i].R->op1_r] = false;        // Mark not ready
+                        m->mapTable[pipe[i].R->op1] = pipe[i].R->op1_r; // Update map table value
                     }
                     // op2 is immediate, nothing needs to happen with it.
 
                     // Pull in other register from map table:
-                    pipe[i].R->op3_r = mapTable[pipe[i].R->op3];
+                    pipe[i].R->op3_r = m->mapTable[pipe[i].R->op3];
 
                     break;
                 case 'S':
@@ -617,12 +906,12 @@ unsigned int rename(frontEndPipe_t *pipe, unsigned int cycle)
                     printf("S-type rename\n");
 #endif
                     // Lookup registers from map table to rename. Don't need anything from the free list :)
-                    pipe[i].R->op1_r = mapTable[pipe[i].R->op1]; // Source register
+                    pipe[i].R->op1_r = m->mapTable[pipe[i].R->op1]; // Source register
 #ifdef RENAME_DEBUG
                     printf("renamed a%d to p%d\n", pipe[i].R->op1, pipe[i].R->op1_r);
 #endif
                     pipe[i].R->op2_r = pipe[i].R->op2;           // Immediate value should be passed through directly
-                    pipe[i].R->op3_r = mapTable[pipe[i].R->op3]; // Destination register
+                    pipe[i].R->op3_r = m->mapTable[pipe[i].R->op3]; // Destination register
                     break;
                 };
 #ifdef RENAME_DEBUG
@@ -641,9 +930,10 @@ unsigned int rename(frontEndPipe_t *pipe, unsigned int cycle)
     return renameStall;
 }
 
-unsigned int decode(frontEndPipe_t *pipe, unsigned int cycle, unsigned int stall)
+unsigned int decode(machine_t *m, unsigned int cycle, unsigned int stall)
 {
-    for (int i = 0; i < ISSUE_WIDTH; i++)
+    frontEndPipe_t *pipe = m->pipe; //!< Lanes of the in-order pipeline
+    for (int i = 0; i < m->issueWidth; i++)
     {
         if (pipe[i].Dc != NOP)
         {
@@ -655,9 +945,8 @@ unsigned int decode(frontEndPipe_t *pipe, unsigned int cycle, unsigned int stall
             pipe[i].R = pipe[i].Dc; // Advance pipeline, containing renamed registers, to rename
 
             // Create a copy of the instruction and assign it to the Dc stage
-            iRecord_t *decodedInstruction = (iRecord_t *)malloc(sizeof(iRecord_t));
-            *decodedInstruction = *pipe[i].Dc;
-            pipe[i].Dc = decodedInstruction;
+            m->decodeCopies[i] = *pipe[i].Dc;
+            pipe[i].Dc = &m->decodeCopies[i];
         }
         else
         {
@@ -676,9 +965,10 @@ unsigned int decode(frontEndPipe_t *pipe, unsigned int cycle, unsigned int stall
  * @param cycle Current cycle the machine is at
  * @param ICOUNT number of instructions completed
  */
-void fetch(frontEndPipe_t *pipe, unsigned int cycle, unsigned int stall, unsigned int ICOUNT, unsigned int *fetchOffset)
+void fetch(machine_t *m, unsigned int cycle, unsigned int stall, unsigned int ICOUNT, unsigned int *fetchOffset)
 {
-    for (int i = 0; i < ISSUE_WIDTH; i++)
+    frontEndPipe_t *pipe = m->pipe; //!< Lanes of the in-order pipeline
+    for (int i = 0; i < m->issueWidth; i++)
     {
         pipe[i].Dc = pipe[i].F; // Advance the pipeline stage
 
@@ -692,7 +982,7 @@ void fetch(frontEndPipe_t *pipe, unsigned int cycle, unsigned int stall, unsigne
             // Create a copy of the instruction and assign it to the F stage
             // iRecord_t *fetchedInstruction = (iRecord_t *)malloc(sizeof(iRecord_t));
             //*fetchedInstruction = instructions[*fetchOffset];
-            pipe[i].F = &instructions[*fetchOffset];
+            pipe[i].F = &m->instructions[*fetchOffset];
             pipe[i].F->fetchIndex = *fetchOffset;
 #ifdef FETCH_DEBUG
             printf("Fetch offset %d: %c, %d, %d, %d on cycle %d\n", *fetchOffset, pipe[i].F->iType, pipe[i].F->op1, pipe[i].F->op2, pipe[i].F->op3, cycle);
@@ -705,7 +995,7 @@ void fetch(frontEndPipe_t *pipe, unsigned int cycle, unsigned int stall, unsigne
             printf("Fetch complete\n");
 #endif
             // No more instructions to fetch, set F stage to NOP
-            for (int i = 0; i < ISSUE_WIDTH; i++)
+            for (int i = 0; i < m->issueWidth; i++)
             {
                 pipe[i].F = NOP;
             }
@@ -721,17 +1011,57 @@ void showdq(deque<unsigned int> g)
     cout << '\n';
 }
 
-int main()
+/**
+ * @brief Brings a machine that ran before back to its reset state with its own copy of a trace. Buffers are only
+ * reallocated when the trace or configuration needs more than the machine already has.
+ *
+ * @param m Machine to reset, set up by initMachine() at some point
+ * @param t Trace to load into instruction memory
+ * @param issueWidth Machine width
+ * @param pregCount Number of physical registers
+ */
+void resetMachine(machine_t *m, const trace_t *t, unsigned int issueWidth, unsigned int pregCount)
 {
-    unsigned int stall = false;
-    unsigned int cycle = 0;                         //!< Current cycle of the system
-    unsigned int completedInsts = 0;                //!< Number of completed instructions
-    const unsigned int ICOUNT = initInstructions(); //!< Number of instructions to process in the system
-    unsigned int fetchOffset = 0;                   //!< Batch to fetch instructions by.
+    m->issueWidth = issueWidth;
+    m->pregCount = pregCount;
+    m->cycle = 0;
+    m->completedInsts = 0;
+    m->fetchOffset = 0;
+    m->stall = false;
+    m->halted = false;
+    m->haltReason = HALT_NONE;
+    m->lastProgress = 0;
+    m->lastCommitted = 0;
+    m->started = chrono::steady_clock::now();
+    m->lastClockCheck = m->started;
+    m->clockStride = 1;
+    m->clockCountdown = 1;
+    m->iqAge = 0;
+    m->freeList.clear();
+    m->reorderBuff.clear();
+    m->issueQueue.clear();
+    m->wBQueue.clear();
+    m->commitQueue.clear();
+    m->robPool.clear();
+
+    // Instruction memory is padded by one fetch group so the initial fetch never runs off the end
+    m->ICOUNT = t->count;
+    if (m->instrCapacity < t->count + issueWidth)
+    {
+        m->instrCapacity = t->count + issueWidth;
+        m->instructions = (iRecord_t *)realloc(m->instructions, m->instrCapacity * sizeof(iRecord_t));
+    }
+    memcpy(m->instructions, t->instrs, t->count * sizeof(iRecord_t));
+    memset(m->instructions + t->count, 0, issueWidth * sizeof(iRecord_t));
 
     // Allocate memory for map and ready tables
-    mapTable = (unsigned int *)calloc(AREG_COUNT, sizeof(unsigned int));   // Map table maps architectural registers to phyiscal registers and is thus AREG_COUNT wide
-    readyTable = (unsigned int *)calloc(PREG_COUNT, sizeof(unsigned int)); // ready table is all the physical registers and is therefore PREG_COUNT wide
+    if (m->mapTable == NULL)
+        m->mapTable = (unsigned int *)calloc(AREG_COUNT, sizeof(unsigned int)); // Map table maps architectural registers to phyiscal registers and is thus AREG_COUNT wide
+    if (m->pregCapacity < pregCount)
+    {
+        m->pregCapacity = pregCount;
+        m->readyTable = (unsigned int *)realloc(m->readyTable, pregCount * sizeof(unsigned int)); // ready table is all the physical registers and is therefore PREG_COUNT wide
+    }
 
     //////////////////   MACHINE INITIALIZATION    /////////////////////////////
     /**
@@ -743,140 +1073,3295 @@ int main()
     // Init mapping table:
     for (int i = 0; i < AREG_COUNT; i++)
     {
-        mapTable[i] = i;
+        m->mapTable[i] = i;
     }
 #ifdef DEBUG_MODE
     for (int i = 0; i < AREG_COUNT; i++)
     {
-        printf("%d => %d\n", i, mapTable[i]);
+        printf("%d => %d\n", i, m->mapTable[i]);
     }
 #endif
 
     // Init ready table
-    for (int i = 0; i < PREG_COUNT; i++)
+    for (int i = 0; i < pregCount; i++)
     {
-        readyTable[i] = true;
+        m->readyTable[i] = true;
     }
 #ifdef DEBUG_MODE
-    for (int i = 0; i < PREG_COUNT; i++)
-        printf("%d => %d\n", i, readyTable[i]);
+    for (int i = 0; i < pregCount; i++)
+        printf("%d => %d\n", i, m->readyTable[i]);
 #endif
     // Init free list
-    for (int i = AREG_COUNT; i < PREG_COUNT; i++)
+    for (int i = AREG_COUNT; i < pregCount; i++)
     {
-        freeList.push_back(i);
+        m->freeList.push_back(i);
     }
 
 #ifdef DEBUG_MODE
     cout << "Raw Free List is: ";
-    showdq(freeList);
+    showdq(m->freeList);
 #endif
 
-    // Allocate memory for pipeline:
-    thePipelineState = (frontEndPipe_t *)calloc(ISSUE_WIDTH, sizeof(frontEndPipe_t));
+    // Allocate memory for pipeline, initialized with NOPs:
+    if (m->widthCapacity < issueWidth)
+    {
+        m->widthCapacity = issueWidth;
+        m->pipe = (frontEndPipe_t *)realloc(m->pipe, issueWidth * sizeof(frontEndPipe_t));
+        m->decodeCopies = (iRecord_t *)realloc(m->decodeCopies, issueWidth * sizeof(iRecord_t));
+    }
+    memset(m->pipe, 0, issueWidth * sizeof(frontEndPipe_t));
 
-    // Allocate memory for members in the pipeline and initialize.
-    for (int i = 0; i < ISSUE_WIDTH; i++)
+    // Fetch initial batch of instructions
+    for (int i = 0; i < issueWidth; i++)
     {
-        thePipelineState[i].F = (iRecord_t *)malloc(sizeof(iRecord_t));
-        thePipelineState[i].Dc = (iRecord_t *)malloc(sizeof(iRecord_t));
-        thePipelineState[i].R = (iRecord_t *)malloc(sizeof(iRecord_t));
-        thePipelineState[i].Di = (iRecord_t *)malloc(sizeof(iRecord_t));
-        thePipelineState[i].IS = (iRecord_t *)malloc(sizeof(iRecord_t));
-        thePipelineState[i].W = (iRecord_t *)malloc(sizeof(iRecord_t));
-        thePipelineState[i].C = (iRecord_t *)malloc(sizeof(iRecord_t));
+        m->pipe[i].F = m->instructions + m->fetchOffset;
+        m->fetchOffset++;
+    }
+#ifdef DEBUG_MODE
+    printf("Will fetch %d", m->fetchOffset);
 
-        // Initialize the pipeline with NOPs:
-        thePipelineState[i].F = thePipelineState[i].Dc = thePipelineState[i].R = thePipelineState[i].Di = thePipelineState[i].IS = thePipelineState[i].W = thePipelineState[i].C = NOP;
+    for (int i = 0; i < issueWidth; i++)
+    {
+        printf("ISSUE_WIDTH=%d:\t%c, %d, %d, %d\n", i, m->pipe[i].F->iType, m->pipe[i].F->op1, m->pipe[i].F->op2, m->pipe[i].F->op3);
     }
+#endif
+}
+
+/**
+ * @brief Brings a fresh machine up to its reset state with its own copy of a trace
+ *
+ * @param m Machine to initialize
+ * @param t Trace to load into instruction memory
+ * @param issueWidth Machine width
+ * @param pregCount Number of physical registers
+ */
+void initMachine(machine_t *m, const trace_t *t, unsigned int issueWidth, unsigned int pregCount)
+{
+    m->instructions = NULL;
+    m->mapTable = m->readyTable = NULL;
+    m->pipe = NULL;
+    m->decodeCopies = NULL;
+    m->instrCapacity = m->pregCapacity = m->widthCapacity = 0;
+    m->telemetry = NULL;
+    m->pipeView = NULL;
+    m->profile = NULL;
+    resetMachine(m, t, issueWidth, pregCount);
+}
 
-    // // Fetch first batch of instructions:
-    // for (int i = 0; i < ISSUE_WIDTH; i++)
-    // {
-    //     thePipelineState[i].F = (iRecord_t *)malloc(sizeof(iRecord_t)); // Allocate memory for iRecord_t
-    //     thePipelineState[i].F->iType = &instructions[fetchOffset].iType;
-    //     thePipelineState[i].F->op1 = &instructions[fetchOffset].op1;
-    //     thePipelineState[i].F->op2 = &instructions[fetchOffset].op2;
-    //     thePipelineState[i].F->op3 = &instructions[fetchOffset].op3;
-    //     thePipelineState[i].F->fetchIndex = fetchOffset;
-    //     fetchOffset++;
-    // }
+/**
+ * @brief Releases the memory owned by a machine
+ *
+ * @param m Machine to tear down
+ */
+void freeMachine(machine_t *m)
+{
+    free(m->instructions);
+    free(m->mapTable);
+    free(m->readyTable);
+    free(m->pipe);
+    free(m->decodeCopies);
+    m->instructions = NULL;
+    m->mapTable = m->readyTable = NULL;
+    m->pipe = NULL;
+    m->decodeCopies = NULL;
+    m->instrCapacity = m->pregCapacity = m->widthCapacity = 0;
+    m->robPool.clear();
+}
 
-    // Fetch initial batch of instructions
-    for (int i = 0; i < ISSUE_WIDTH; i++)
+/**
+ * @brief Moves a pointer into one machine's instruction memory or decode copies over to another machine's
+ *
+ * @param dst Machine to point into
+ * @param src Machine p points into
+ * @param p Pointer to move, NOP stays NOP
+ * @return iRecord_t* Pointer to the same record in dst
+ */
+iRecord_t *relocate(const machine_t *dst, const machine_t *src, iRecord_t *p)
+{
+    if (p == NOP)
+        return NOP;
+    if (p >= src->instructions && p < src->instructions + src->instrCapacity)
+        return dst->instructions + (p - src->instructions);
+    return dst->decodeCopies + (p - src->decodeCopies);
+}
+
+/**
+ * @brief Makes a fresh machine an exact copy of another that can be simulated on its own from there. Telemetry, pipeline
+ * view and profile stay with src.
+ *
+ * @param dst Machine to set up, not initialized yet
+ * @param src Machine to copy
+ */
+void cloneMachine(machine_t *dst, const machine_t *src)
+{
+    const unsigned int records = src->ICOUNT + src->issueWidth;
+    dst->instrCapacity = records;
+    dst->pregCapacity = src->pregCount;
+    dst->widthCapacity = src->issueWidth;
+    dst->instructions = (iRecord_t *)malloc(records * sizeof(iRecord_t));
+    dst->mapTable = (unsigned int *)malloc(AREG_COUNT * sizeof(unsigned int));
+    dst->readyTable = (unsigned int *)malloc(src->pregCount * sizeof(unsigned int));
+    dst->pipe = (frontEndPipe_t *)malloc(src->issueWidth * sizeof(frontEndPipe_t));
+    dst->decodeCopies = (iRecord_t *)malloc(src->issueWidth * sizeof(iRecord_t));
+
+    dst->issueWidth = src->issueWidth;
+    dst->pregCount = src->pregCount;
+    dst->ICOUNT = src->ICOUNT;
+    dst->iqAge = src->iqAge;
+    dst->cycle = src->cycle;
+    dst->completedInsts = src->completedInsts;
+    dst->fetchOffset = src->fetchOffset;
+    dst->stall = src->stall;
+    dst->halted = src->halted;
+    dst->haltReason = src->haltReason;
+    dst->lastProgress = src->lastProgress;
+    dst->lastCommitted = src->lastCommitted;
+    dst->started = src->started;
+    dst->lastClockCheck = src->lastClockCheck;
+    dst->clockStride = src->clockStride;
+    dst->clockCountdown = src->clockCountdown;
+    dst->telemetry = NULL;
+    dst->pipeView = NULL;
+    dst->profile = NULL;
+    memcpy(dst->instructions, src->instructions, records * sizeof(iRecord_t));
+    memcpy(dst->decodeCopies, src->decodeCopies, src->issueWidth * sizeof(iRecord_t));
+    memcpy(dst->mapTable, src->mapTable, AREG_COUNT * sizeof(unsigned int));
+    memcpy(dst->readyTable, src->readyTable, src->pregCount * sizeof(unsigned int));
+    dst->freeList = src->freeList;
+
+    for (int i = 0; i < src->issueWidth; i++)
     {
-        thePipelineState[i].F = instructions + fetchOffset;
-        fetchOffset++;
+        dst->pipe[i].F = relocate(dst, src, src->pipe[i].F);
+        dst->pipe[i].Dc = relocate(dst, src, src->pipe[i].Dc);
+        dst->pipe[i].R = relocate(dst, src, src->pipe[i].R);
+        dst->pipe[i].Di = relocate(dst, src, src->pipe[i].Di);
+        dst->pipe[i].IS = relocate(dst, src, src->pipe[i].IS);
+        dst->pipe[i].W = relocate(dst, src, src->pipe[i].W);
+        dst->pipe[i].C = relocate(dst, src, src->pipe[i].C);
     }
-#ifdef DEBUG_MODE
-    printf("Will fetch %d", fetchOffset);
 
-    for (int i = 0; i < ISSUE_WIDTH; i++)
+    dst->issueQueue = src->issueQueue;
+    for (int i = 0; i < dst->issueQueue.size(); i++)
+        dst->issueQueue[i].instr = relocate(dst, src, dst->issueQueue[i].instr);
+    dst->wBQueue = src->wBQueue;
+    for (int i = 0; i < dst->wBQueue.size(); i++)
+        dst->wBQueue[i] = relocate(dst, src, dst->wBQueue[i]);
+    dst->commitQueue = src->commitQueue;
+    for (int i = 0; i < dst->commitQueue.size(); i++)
+        dst->commitQueue[i] = relocate(dst, src, dst->commitQueue[i]);
+
+    // ROB entries live in the pool in ROB order, walk both together to find each one's copy:
+    dst->robPool = src->robPool;
+    for (int j = 0; j < dst->robPool.size(); j++)
+        dst->robPool[j].instr = relocate(dst, src, dst->robPool[j].instr);
+    dst->reorderBuff.clear();
+    int j = 0;
+    for (int i = 0; i < src->reorderBuff.size(); i++)
     {
-        printf("ISSUE_WIDTH=%d:\t%c, %d, %d, %d\n", i, thePipelineState[i].F->iType, thePipelineState[i].F->op1, thePipelineState[i].F->op2, thePipelineState[i].F->op3);
+        while (&src->robPool[j] != src->reorderBuff[i])
+            j++;
+        dst->reorderBuff.push_back(&dst->robPool[j]);
     }
+}
+
+/**
+ * @brief Reads the time stamp counter, or a nanosecond clock where there is none
+ *
+ * @return unsigned long long Ticks
+ */
+static inline unsigned long long readTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
 #endif
+}
 
-#ifdef DEBUG_MODE
-    // Print instructions:
-    printf("INSTRUCTIONS TO BE PROCESSED:\n");
-    for (int i = 0; i < ICOUNT; i++)
+/**
+ * @brief Sets up profiling of the stage functions. Opens the hardware counters as one group on the calling thread; if
+ * the kernel refuses any of them, profiling falls back to timing only.
+ *
+ * @param p Profile to set up
+ */
+void openProfile(stageProfile_t *p)
+{
+    memset(p->stages, 0, sizeof(p->stages));
+    p->counters = 0;
+    p->leader = -1;
+#ifdef __linux__
+    for (int c = 0; c < PROFILE_COUNTERS; c++)
     {
-        printf("%c %d %d %d\n", instructions[i].iType, instructions[i].op1, instructions[i].op2, instructions[i].op3);
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = profileEvents[c];
+        attr.disabled = c == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        int fd = syscall(__NR_perf_event_open, &attr, 0, -1, p->leader, 0);
+        if (fd < 0)
+        {
+            p->error = errno;
+            for (int k = 0; k < c; k++)
+                close(p->fds[k]);
+            p->counters = 0;
+            p->leader = -1;
+            break;
+        }
+        p->fds[c] = fd;
+        p->counters = c + 1;
+        if (c == 0)
+            p->leader = fd;
     }
-    printf("==========================================\n");
+    if (p->leader >= 0)
+        ioctl(p->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    p->error = ENOSYS;
 #endif
-    while (completedInsts < ICOUNT)
+    p->started = chrono::steady_clock::now();
+    p->startTicks = readTicks();
+}
+
+/**
+ * @brief Reads the counter group and the tick counter at the start or end of a stage
+ *
+ * @param p Profile with the counters
+ * @param mark Receives the readings
+ */
+static inline void profileMark(const stageProfile_t *p, profileMark_t *mark)
+{
+    if (p->counters)
     {
-#ifdef DEBUG_MODE
-        printf("\n\n========= CYCLE %d ==========\n", cycle);
-        // printf("RT:\n");
-        // for(int i = 0; i < PREG_COUNT; i++)
-        // {
-        //     printf("%d  %d\n", i, readyTable[i]);
-        // }
+        unsigned long long buf[1 + PROFILE_COUNTERS];
+        if (read(p->leader, buf, sizeof(buf)) == (ssize_t)sizeof(buf))
+            memcpy(mark->counts, buf + 1, sizeof(mark->counts));
+    }
+    mark->ticks = readTicks();
+}
+
+/**
+ * @brief Charges the time and counts since a mark to a stage
+ *
+ * @param p Profile to charge
+ * @param stage Stage that ran since the mark
+ * @param start Readings from before the stage ran
+ */
+static inline void profileCharge(stageProfile_t *p, int stage, const profileMark_t *start)
+{
+    unsigned long long ticks = readTicks() - start->ticks;
+    stageStats_t *s = &p->stages[stage];
+    s->calls++;
+    s->ticks += ticks;
+    s->hist[min(PROFILE_BUCKETS - 1, ticks ? 64 - __builtin_clzll(ticks) : 0)]++;
+    if (p->counters)
+    {
+        profileMark_t end;
+        profileMark(p, &end);
+        for (int c = 0; c < PROFILE_COUNTERS; c++)
+            s->counts[c] += end.counts[c] - start->counts[c];
+    }
+}
+
+/**
+ * @brief Timing hook run before each stage of stepMachine(), does nothing on a machine without a profile
+ *
+ * @param m Machine about to run the stage
+ * @param mark Receives the readings the stage is charged from
+ */
+static inline void stageBegin(const machine_t *m, profileMark_t *mark)
+{
+    if (m->profile != NULL)
+        profileMark(m->profile, mark);
+}
+
+/**
+ * @brief Timing hook run after each stage of stepMachine(), does nothing on a machine without a profile
+ *
+ * @param m Machine that ran the stage
+ * @param stage Stage that ran
+ * @param mark Readings from stageBegin()
+ */
+static inline void stageEnd(machine_t *m, int stage, const profileMark_t *mark)
+{
+    if (m->profile != NULL)
+        profileCharge(m->profile, stage, mark);
+}
+
+/**
+ * @brief Value below which a fraction of a stage's calls fell, from its histogram
+ *
+ * @param s Stage statistics
+ * @param q Fraction of the calls, 0 to 1
+ * @return unsigned long long Upper bound of the bucket the fraction ends in, in ticks
+ */
+unsigned long long profilePercentile(const stageStats_t *s, double q)
+{
+    unsigned long long seen = 0;
+    for (int b = 0; b < PROFILE_BUCKETS; b++)
+    {
+        seen += s->hist[b];
+        if (seen >= q * s->calls)
+            return b ? 1ull << b : 0;
+    }
+    return ~0ull;
+}
+
+/**
+ * @brief Prints the totals and per-cycle distribution of each stage, then closes the counters
+ *
+ * @param p Profile to report
+ */
+void closeProfile(stageProfile_t *p)
+{
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - p->started).count();
+    unsigned long long ticks = readTicks() - p->startTicks;
+    double nsPerTick = ticks ? seconds * 1e9 / ticks : 0.0;
+    unsigned long long total = 0;
+    for (int st = 0; st < PROF_STAGES; st++)
+        total += p->stages[st].ticks;
+
+    printf("Stage profile: %.3f s, %.1f%% of it in the stage functions\n", seconds,
+           ticks ? 100.0 * total / ticks : 0.0);
+    printf("  %-10s %10s %10s %6s %10s %10s %10s %10s\n", "stage", "calls", "ms", "%", "ns/cycle", "p50 ns", "p90 ns", "p99 ns");
+    for (int st = 0; st < PROF_STAGES; st++)
+    {
+        const stageStats_t *s = &p->stages[st];
+        printf("  %-10s %10llu %10.2f %6.1f %10.1f %10.0f %10.0f %10.0f\n", profileStageNames[st], s->calls, s->ticks * nsPerTick / 1e6,
+               total ? 100.0 * s->ticks / total : 0.0, s->calls ? s->ticks * nsPerTick / s->calls : 0.0,
+               profilePercentile(s, 0.50) * nsPerTick, profilePercentile(s, 0.90) * nsPerTick, profilePercentile(s, 0.99) * nsPerTick);
+    }
 
-        printf("EXTERN ROB STATE:\n");
-        for (int i = 0; i < reorderBuff.size(); i++)
+    if (p->counters)
+    {
+        printf("  %-10s", "stage");
+        for (int c = 0; c < PROFILE_COUNTERS; c++)
+            printf(" %14s", profileCounterNames[c]);
+        printf(" %6s\n", "IPC");
+        for (int st = 0; st < PROF_STAGES; st++)
         {
-            printf("%c %d r%d\n", reorderBuff[i]->instr->iType, reorderBuff[i]->instr->op1_r, reorderBuff[i]->ready);
+            const stageStats_t *s = &p->stages[st];
+            printf("  %-10s", profileStageNames[st]);
+            for (int c = 0; c < PROFILE_COUNTERS; c++)
+                printf(" %14llu", s->counts[c]);
+            printf(" %6.2f\n", s->counts[0] ? (double)s->counts[1] / s->counts[0] : 0.0);
         }
+        for (int c = 0; c < PROFILE_COUNTERS; c++)
+            close(p->fds[c]);
+    }
+    else
+        printf("  hardware counters unavailable (%s), timing only\n", strerror(p->error));
+}
+
+/**
+ * @brief Runs the back end stages of one cycle, commit through dispatch
+ *
+ * @param m Machine to advance
+ */
+void stepBackEnd(machine_t *m)
+{
+    profileMark_t mark;
+
+    m->readyTable[0] = true; // Ensure p0 is always ready
+    stageBegin(m, &mark);
+    m->completedInsts = commit(m, m->completedInsts, m->cycle);
+    stageEnd(m, PROF_COMMIT, &mark);
+    stageBegin(m, &mark);
+    writeback(m, m->cycle);
+    stageEnd(m, PROF_WRITEBACK, &mark);
+    stageBegin(m, &mark);
+    issue(m, m->cycle);
+    stageEnd(m, PROF_ISSUE, &mark);
+    stageBegin(m, &mark);
+    dispatch(m, m->cycle);
+    stageEnd(m, PROF_DISPATCH, &mark);
+}
+
+/**
+ * @brief Runs rename for one cycle and keeps its stall signal for decode
+ *
+ * @param m Machine to advance
+ */
+void stepRename(machine_t *m)
+{
+    profileMark_t mark;
+
+    stageBegin(m, &mark);
+    m->stall = rename(m, m->cycle);
+    stageEnd(m, PROF_RENAME, &mark);
+}
+
+/**
+ * @brief Runs the front end stages of one cycle, decode then fetch, under the stall signal rename left in the machine
+ *
+ * @param m Machine to advance
+ */
+void stepFrontEnd(machine_t *m)
+{
+    profileMark_t mark;
+
+    stageBegin(m, &mark);
+    m->stall = decode(m, m->cycle, m->stall);
+    stageEnd(m, PROF_DECODE, &mark);
+    stageBegin(m, &mark);
+    fetch(m, m->cycle, m->stall, m->ICOUNT, &m->fetchOffset);
+    stageEnd(m, PROF_FETCH, &mark);
+}
+
+/**
+ * @brief Advances the machine by one cycle. Stages run back to front so each one sees the previous cycle's state. A
+ * machine with a profile has every stage function timed and counted as it runs.
+ *
+ * @param m Machine to advance
+ */
+void stepMachine(machine_t *m)
+{
+#ifdef DEBUG_MODE
+    printf("\n\n========= CYCLE %d ==========\n", m->cycle);
+
+    printf("EXTERN ROB STATE:\n");
+    for (int i = 0; i < m->reorderBuff.size(); i++)
+    {
+        printf("%c %d r%d\n", m->reorderBuff[i]->instr->iType, m->reorderBuff[i]->instr->op1_r, m->reorderBuff[i]->ready);
+    }
 #endif
 
-        readyTable[0] = true; // Ensure p0 is always ready
-        completedInsts = commit(thePipelineState, completedInsts, cycle);
-        writeback(thePipelineState, cycle);
-        issue(thePipelineState, cycle);
-        dispatch(thePipelineState, cycle);
-        stall = rename(thePipelineState, cycle);
-        stall = decode(thePipelineState, cycle, stall);
-        fetch(thePipelineState, cycle, stall, ICOUNT, &fetchOffset);
+    stepBackEnd(m);
+    stepRename(m);
+    stepFrontEnd(m);
 
 #ifdef DEBUG_MODE
-        printf("Completed insts %d\n", completedInsts);
+    printf("Completed insts %d\n", m->completedInsts);
 #endif
-        // completedInsts++;
+}
 
-        if (cycle == 15)
-            break;
-        ++cycle;
+/**
+ * @brief Creates and maps a telemetry block in shared memory for readers started with --attach
+ *
+ * @param w Writer to set up
+ * @param name Shared memory object name, with or without the leading slash
+ * @param every Cycles between updates
+ * @return int 0 on success, -1 if the block could not be created
+ */
+int openTelemetry(telemetryWriter_t *w, const char *name, unsigned int every)
+{
+    snprintf(w->name, sizeof(w->name), "%s%s", name[0] == '/' ? "" : "/", name);
+    int fd = shm_open(w->name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        printf("error: cannot create telemetry block %s: %s\n", w->name, strerror(errno));
+        return -1;
+    }
+    void *p = MAP_FAILED;
+    if (ftruncate(fd, sizeof(telemetry_t)) == 0)
+        p = mmap(NULL, sizeof(telemetry_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        printf("error: cannot map telemetry block %s: %s\n", w->name, strerror(errno));
+        shm_unlink(w->name);
+        return -1;
     }
 
-    printRecords(ICOUNT);
+    w->block = new (p) telemetry_t;
+    w->block->seq.store(0);
+    w->block->pid.store(getpid());
+    w->block->running.store(1);
+    w->block->haltReason.store(HALT_NONE);
+    w->block->magic.store(TELEMETRY_MAGIC, memory_order_release);
+    w->every = max(1u, every);
+    w->lastCycle = 0;
+    w->lastCommitted = 0;
+    w->lastTime = chrono::steady_clock::now();
+    return 0;
+}
+
+/**
+ * @brief Copies the machine's progress into its telemetry block
+ *
+ * @param m Machine with a telemetry writer
+ */
+void publishTelemetry(machine_t *m)
+{
+    telemetryWriter_t *w = m->telemetry;
+    telemetry_t *b = w->block;
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    double interval = chrono::duration<double>(now - w->lastTime).count();
+    unsigned int cycles = m->cycle - w->lastCycle;
+    unsigned int commits = m->completedInsts - w->lastCommitted;
+
+    b->seq.fetch_add(1, memory_order_acq_rel);
+    b->cycle.store(m->cycle, memory_order_relaxed);
+    b->committed.store(m->completedInsts, memory_order_relaxed);
+    b->ICOUNT.store(m->ICOUNT, memory_order_relaxed);
+    b->robOccupancy.store(m->reorderBuff.size(), memory_order_relaxed);
+    b->iqOccupancy.store(m->issueQueue.size(), memory_order_relaxed);
+    b->freeRegs.store(m->freeList.size(), memory_order_relaxed);
+    if (cycles > 0)
+        b->ipc.store(commits / (double)cycles, memory_order_relaxed);
+    if (interval > 0.0)
+        b->instrsPerSec.store(commits / interval, memory_order_relaxed);
+    b->seconds.store(chrono::duration<double>(now - m->started).count(), memory_order_relaxed);
+    b->seq.fetch_add(1, memory_order_release);
+
+    w->lastCycle = m->cycle;
+    w->lastCommitted = m->completedInsts;
+    w->lastTime = now;
+}
+
+/**
+ * @brief Publishes the final state of the run, then removes the block's name so no new reader can attach. Readers
+ * already attached keep their mapping and see the run is over.
+ *
+ * @param m Machine the writer was publishing
+ */
+void closeTelemetry(machine_t *m)
+{
+    telemetryWriter_t *w = m->telemetry;
+    publishTelemetry(m);
+    w->block->haltReason.store(m->haltReason);
+    w->block->running.store(0, memory_order_release);
+    munmap(w->block, sizeof(telemetry_t));
+    shm_unlink(w->name);
+    m->telemetry = NULL;
+}
+
+/**
+ * @brief Opens a pipeline view export. Records are written in the gem5 O3PipeView format that Konata reads, in commit
+ * order, as soon as each instruction commits, so memory use does not grow with the length of the run.
+ *
+ * @param v Export to set up, with the sampling fields already filled in
+ * @param fileName File to write
+ * @return int 0 on success, -1 if the file could not be opened
+ */
+int openPipeView(pipeView_t *v, const char *fileName)
+{
+    v->out = fopen(fileName, "w");
+    if (v->out == NULL)
+    {
+        printf("error: cannot write pipeline view %s: %s\n", fileName, strerror(errno));
+        return -1;
+    }
+    setvbuf(v->out, NULL, _IOFBF, PIPEVIEW_BUFFER);
+    v->next = v->first;
+    v->written = 0;
+    v->seen = 0;
+    return 0;
+}
+
+/**
+ * @brief Moves an index up to the first instruction at or after it that the sampling window takes
+ *
+ * @param v Export with the window
+ * @param i Instruction index
+ * @return unsigned int First sampled index at or after i, UINT_MAX if there is none
+ */
+unsigned int nextSampled(const pipeView_t *v, unsigned int i)
+{
+    if (i < v->first)
+        i = v->first;
+    if (i < v->last && v->period && (i - v->first) % v->period >= v->count)
+        i = v->first + ((i - v->first) / v->period + 1) * v->period;
+    return i < v->last ? i : UINT_MAX;
+}
+
+/**
+ * @brief Operands of an instruction that name a register it reads, with the same operand semantics as rename()
+ *
+ * @param in Instruction to look at
+ * @param ops Receives up to two operand numbers, 0 to 2 for op1 to op3
+ * @return int Number of source operands
+ */
+int sourceOperands(const iRecord_t *in, int *ops)
+{
+    int n = 0;
+    switch (in->iType)
+    {
+    case 'R': // op2, op3 dynamic
+        ops[n++] = 1;
+        ops[n++] = 2;
+        break;
+    case 'I': // op2 dynamic, op3 immediate
+        ops[n++] = 1;
+        break;
+    case 'L': // op2 immediate, op3 dynamic
+        ops[n++] = 2;
+        break;
+    case 'S': // op1 source, op2 immediate, op3 dynamic
+        ops[n++] = 0;
+        ops[n++] = 2;
+        break;
+    };
+
+    // Registers outside the map table are treated as immediates:
+    int kept = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int reg = in->*archOperands[ops[i]];
+        if (reg >= 0 && reg < AREG_COUNT)
+            ops[kept++] = ops[i];
+    }
+    return kept;
+}
+
+/**
+ * @brief Architectural register an instruction writes, with the same semantics as rename()
+ *
+ * @param in Instruction to look at
+ * @return int Destination register, -1 if the instruction takes nothing off the free list
+ */
+int destReg(const iRecord_t *in)
+{
+    if (in->op1 < 0 || in->op1 >= AREG_COUNT)
+        return -1;
+    switch (in->iType)
+    {
+    case 'R':
+    case 'L':
+        return in->op1 != 0 ? in->op1 : -1; // Writes to r0 are not renamed
+    case 'I':
+        return in->op1; // I-types are always renamed
+    default:
+        return -1;
+    };
+}
+
+/**
+ * @brief Writes one instruction's stage transitions. Stages the instruction never reached are written as tick 0, which
+ * viewers show as squashed.
+ *
+ * @param m Machine the instruction ran on
+ * @param v Export to write to
+ * @param i Instruction index
+ * @param retired Cycle the instruction was seen committed on, for when commit left no C stamp, UINT_MAX if it did not commit
+ * @param projected Set for instructions fast mode committed by extrapolation, which were never renamed: their registers
+ * are left out and the record is marked projected instead. Otherwise the label lists the physical registers the
+ * instruction read, then the one it wrote after an arrow; immediates are left out.
+ */
+void writePipeView(const machine_t *m, pipeView_t *v, unsigned int i, unsigned int retired, bool projected)
+{
+    static const char *const stageNames[] = {"fetch", "decode", "rename", "dispatch", "issue", "complete", "retire"};
+    const iRecord_t *in = &m->instructions[i];
+    unsigned long long ticks[PIPE_DEPTH];
+    for (int s = 0; s < PIPE_DEPTH; s++)
+    {
+        unsigned int stamp = in->*stageStamps[s];
+        if (s == PIPE_DEPTH - 1 && stamp == 0 && retired != UINT_MAX)
+            stamp = retired;
+        bool reached = stamp != 0 || (s == 0 && i < m->issueWidth); // Only the first fetch group leaves fetch on cycle 0
+        ticks[s] = reached ? (stamp + 1ull) * PIPEVIEW_TICKS : 0; // Tick 0 means not reached, so cycle 0 is tick 1 cycle
+    }
+    bool dispatched = ticks[3] != 0;
+
+    fprintf(v->out, "O3PipeView:fetch:%llu:0x%08x:0:%u:%c %d %d %d", ticks[0], i * 4, i + 1, in->iType, in->op1, in->op2,
+            in->op3);
+    if (projected)
+        fprintf(v->out, " | projected");
+    else
+    {
+        int srcs[2];
+        int n = sourceOperands(in, srcs);
+        fputs(" |", v->out);
+        for (int k = 0; k < n; k++)
+            fprintf(v->out, " p%d", in->*renamedOperands[srcs[k]]);
+        if (destReg(in) >= 0)
+            fprintf(v->out, " -> p%d", in->op1_r);
+    }
+    if (dispatched && ticks[4])
+        fprintf(v->out, " | IQ %u", in->IS - in->Di);
+    if (dispatched && ticks[6])
+        fprintf(v->out, " ROB %llu", ticks[6] / PIPEVIEW_TICKS - 1 - in->Di);
+    fputc('\n', v->out);
+    for (int s = 1; s < PIPE_DEPTH - 1; s++)
+        fprintf(v->out, "O3PipeView:%s:%llu\n", stageNames[s], ticks[s]);
+    fprintf(v->out, "O3PipeView:retire:%llu:store:0\n", ticks[6]);
+    v->written++;
+}
+
+/**
+ * @brief Writes every sampled instruction that committed since the last call. Called at the end of every cycle, so
+ * everything that committed since committed on this one.
+ *
+ * @param m Machine with a pipeline view export
+ */
+void streamPipeView(machine_t *m)
+{
+    pipeView_t *v = m->pipeView;
+    for (; v->seen < m->completedInsts; v->seen++)
+        v->retired[v->seen % PIPEVIEW_HISTORY] = m->cycle;
+    while ((v->next = nextSampled(v, v->next)) < m->completedInsts)
+    {
+        writePipeView(m, v, v->next, v->retired[v->next % PIPEVIEW_HISTORY], false);
+        v->next++;
+    }
+}
+
+/**
+ * @brief Writes the sampled instructions fast mode committed by extrapolation. The loop commits on the same cycles of
+ * every iteration, so each one committed delta cycles after the instruction commits places before it.
+ *
+ * @param m Machine with a pipeline view export, just fast-forwarded
+ * @param commits Instructions committed per iteration
+ * @param delta Cycles per iteration
+ */
+void skipPipeView(machine_t *m, unsigned int commits, unsigned int delta)
+{
+    pipeView_t *v = m->pipeView;
+    if (commits == 0 || commits > PIPEVIEW_HISTORY) // Too long a loop to remember, count them as committed now
+        return;
+
+    const unsigned int from = v->seen;
+    vector<unsigned int> iteration(commits);
+    for (unsigned int k = 0; k < commits; k++)
+        iteration[k] = v->retired[(from - commits + k) % PIPEVIEW_HISTORY];
+
+    while ((v->next = nextSampled(v, v->next)) < m->completedInsts)
+    {
+        unsigned int y = v->next - from;
+        writePipeView(m, v, v->next, iteration[y % commits] + (y / commits + 1) * delta, true);
+        v->next++;
+    }
+    for (unsigned int y = max(from, m->completedInsts - min(m->completedInsts, (unsigned int)PIPEVIEW_HISTORY)); y < m->completedInsts; y++)
+        v->retired[y % PIPEVIEW_HISTORY] = iteration[(y - from) % commits] + ((y - from) / commits + 1) * delta;
+    v->seen = m->completedInsts;
+}
+
+/**
+ * @brief Writes the sampled instructions that were fetched but had not committed when the run ended, then closes the file
+ *
+ * @param m Machine the export was streaming
+ */
+void closePipeView(machine_t *m)
+{
+    pipeView_t *v = m->pipeView;
+    streamPipeView(m);
+    while ((v->next = nextSampled(v, v->next)) < m->fetchOffset)
+        writePipeView(m, v, v->next++, UINT_MAX, false);
+    fclose(v->out);
+    m->pipeView = NULL;
+}
+
+/**
+ * @brief Moves the watchdog's last progress mark up to now if anything committed since it was last looked at
+ *
+ * @param m Machine being simulated
+ */
+void noteProgress(machine_t *m)
+{
+    if (m->completedInsts != m->lastCommitted)
+    {
+        m->lastCommitted = m->completedInsts;
+        m->lastProgress = m->cycle;
+    }
+}
+
+/**
+ * @brief Looks at the wall clock for the time budget, then sizes the stride to the next look. Cycles get slower as the
+ * queues fill, so the stride follows the time the last one took, at most doubling, and never reaches past the budget.
+ *
+ * @param m Machine whose countdown to the next look ran out
+ * @return true The time budget is spent
+ * @return false There is time left, m->clockCountdown is set to the next look
+ */
+bool clockExpired(machine_t *m)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    double left = theBudget.maxSeconds - chrono::duration<double>(now - m->started).count();
+    if (left <= 0.0)
+        return true;
+
+    double since = chrono::duration<double>(now - m->lastClockCheck).count();
+    double target = min(CLOCK_CHECK_SECONDS, left);
+    double stride = since > 0.0 ? m->clockStride * target / since : 2.0 * m->clockStride;
+    m->clockStride = (unsigned int)max(1.0, min(stride, 2.0 * m->clockStride));
+    m->clockCountdown = m->clockStride;
+    m->lastClockCheck = now;
+    return false;
+}
+
+/**
+ * @brief Closes out a simulated cycle: feeds the watchdog and telemetry, then checks the run budget.
+ *
+ * @param m Machine that just finished m->cycle
+ * @return true The machine may go on, m->cycle has moved to the next cycle
+ * @return false A budget ran out, the machine is halted and m->cycle is left on the last cycle simulated
+ */
+bool endCycle(machine_t *m)
+{
+    noteProgress(m);
+    if (m->telemetry != NULL && m->cycle - m->telemetry->lastCycle >= m->telemetry->every)
+        publishTelemetry(m);
+    if (m->pipeView != NULL)
+        streamPipeView(m);
+
+    haltReason_t reason = HALT_NONE;
+    if (m->completedInsts >= m->ICOUNT) // Finished this cycle, even if a budget ran out on it too
+        reason = HALT_NONE;
+    else if (theBudget.maxCycles && m->cycle >= theBudget.maxCycles)
+        reason = HALT_CYCLES;
+    else if (theBudget.maxCommitted && m->completedInsts >= theBudget.maxCommitted)
+        reason = HALT_COMMITTED;
+    else if (theBudget.stallCycles && m->cycle - m->lastProgress >= theBudget.stallCycles)
+        reason = HALT_WATCHDOG;
+    else if (theBudget.maxSeconds > 0.0 && --m->clockCountdown == 0 && clockExpired(m))
+        reason = HALT_CLOCK;
+
+    if (reason != HALT_NONE)
+    {
+        m->halted = true;
+        m->haltReason = reason;
+        return false;
+    }
+    ++m->cycle;
+    return true;
+}
+
+/**
+ * @brief A stretch of the trace in which one block of instructions repeats back to back.
+ *
+ */
+typedef struct loopRegion_t
+{
+    unsigned int start;  //!< First instruction of the first iteration
+    unsigned int period; //!< Instructions per iteration
+    unsigned int end;    //!< One past the last instruction that still follows the pattern
+} loopRegion_t;
+
+/**
+ * @brief Machine state at an iteration boundary, kept so a later boundary can be matched against it.
+ *
+ */
+typedef struct loopSnapshot_t
+{
+    vector<int> signature;       //!< Machine state projected onto the loop body (see projectState())
+    unsigned int iteration;      //!< Iteration of the loop fetch had reached
+    unsigned int cycle;          //!< Cycle the snapshot was taken at the end of
+    unsigned int completedInsts; //!< Committed instructions at the snapshot
+    unsigned long long iqAge;    //!< IQ age tracker at the snapshot
+    unsigned int oldest;         //!< Oldest instruction still in flight at the snapshot
+    size_t freeRegs;             //!< Free list length at the snapshot
+} loopSnapshot_t;
+
+/**
+ * @brief Bookkeeping for the steady-state fast mode of runMachine()
+ *
+ */
+typedef struct fastForward_t
+{
+    deque<loopRegion_t> loops;      //!< Loop regions found in the trace, in trace order
+    unsigned int curLoop;           //!< First region that fetch has not run past yet
+    int lastIteration;              //!< Iteration of curLoop seen at the last boundary, -1 if none
+    deque<loopSnapshot_t> history;  //!< Most recent boundary snapshots in curLoop, oldest first
+    unsigned int skips;             //!< Number of times the machine was fast-forwarded
+    unsigned long long skippedCycles; //!< Cycles that were extrapolated rather than simulated
+} fastForward_t;
+
+/**
+ * @brief Compares the instruction memory part of two records
+ *
+ * @return true if both records hold the same instruction
+ */
+bool sameInstr(const iRecord_t *a, const iRecord_t *b)
+{
+    return a->iType == b->iType && a->op1 == b->op1 && a->op2 == b->op2 && a->op3 == b->op3;
+}
+
+/**
+ * @brief Finds the regions of the trace where one block of instructions repeats back to back at least LOOP_MIN_ITERS times.
+ * At each position the period covering the most instructions wins, ties going to the shorter period.
+ *
+ * @param instr Instruction memory
+ * @param count Number of instructions in instr
+ * @return deque<loopRegion_t> Non-overlapping loop regions in trace order
+ */
+deque<loopRegion_t> findLoops(const iRecord_t *instr, unsigned int count)
+{
+    deque<loopRegion_t> loops;
+    unsigned int i = 0;
+
+    while (i < count)
+    {
+        loopRegion_t best = {i, 0, i};
+        for (unsigned int period = 1; period <= LOOP_MAX_PERIOD && i + period < count; period++)
+        {
+            unsigned int run = 0; // Instructions that match the one a period later
+            while (i + run + period < count && sameInstr(&instr[i + run], &instr[i + run + period]))
+                run++;
+
+            if (run >= period * (LOOP_MIN_ITERS - 1) && run + period > best.end - best.start)
+            {
+                best.period = period;
+                best.end = i + run + period;
+            }
+        }
+
+        if (best.period != 0)
+        {
+#ifdef DEBUG_MODE
+            printf("Loop of %u instructions from %u to %u\n", best.period, best.start, best.end);
+#endif
+            loops.push_back(best);
+            i = best.end;
+        }
+        else
+            i++;
+    }
+    return loops;
+}
+
+/**
+ * @brief Names a physical register by the order it was first seen in, so states that only differ by a renaming match
+ *
+ * @param names Name of every register seen so far, -1 for the others
+ * @param next Next name to hand out
+ * @param reg Register to name
+ * @return int Name of reg
+ */
+int canonReg(vector<int> &names, int *next, int reg)
+{
+    if (reg < 0 || reg >= 1 << 16) // Immediates passed through rename, kept as they are
+        return INT_MIN + 1 + (reg & 0xffff);
+    if (reg >= names.size())
+        names.resize(reg + 1, -1);
+    if (names[reg] < 0)
+        names[reg] = (*next)++;
+    return names[reg];
+}
+
+/**
+ * @brief Projects the machine state onto a loop iteration: every instruction is named by its distance from base and every
+ * physical register by the order it is first seen in (see canonReg()). Two boundaries with the same projection are taken to
+ * behave the same from there on. Commit puts a register back on the free list for every lane, so the list keeps growing in
+ * a loop that renames; only its first freeCap registers go into the projection.
+ *
+ * @param m Machine to project
+ * @param base First instruction of the iteration fetch is in
+ * @param freeCap Registers at the front of the free list that go into the projection
+ * @param sig Receives the projection
+ * @return unsigned int Oldest instruction still in flight, fetchOffset if the machine is empty
+ */
+unsigned int projectState(const machine_t *m, unsigned int base, unsigned int freeCap, vector<int> &sig)
+{
+    unsigned int oldest = m->fetchOffset;
+    vector<int> names;
+    int next = 0;
+
+    sig.clear();
+    sig.push_back(m->fetchOffset - base);
+    for (int a = 0; a < AREG_COUNT; a++)
+    {
+        sig.push_back(canonReg(names, &next, m->mapTable[a]));
+        sig.push_back(m->readyTable[m->mapTable[a]]);
+    }
+
+    for (int i = 0; i < m->issueWidth; i++)
+    {
+        iRecord_t *lane[] = {m->pipe[i].F, m->pipe[i].Dc, m->pipe[i].R, m->pipe[i].Di};
+        for (int s = 0; s < 4; s++)
+        {
+            if (lane[s] == NOP)
+            {
+                sig.push_back(INT_MIN);
+                continue;
+            }
+            unsigned int idx = lane[s] - m->instructions;
+            oldest = min(oldest, idx);
+            sig.push_back(idx - base);
+            if (s == 3) // Renamed already
+            {
+                sig.push_back(canonReg(names, &next, lane[s]->op1_r));
+                sig.push_back(canonReg(names, &next, lane[s]->op2_r));
+                sig.push_back(canonReg(names, &next, lane[s]->op3_r));
+            }
+        }
+    }
+
+    sig.push_back(m->issueQueue.size());
+    for (int i = 0; i < m->issueQueue.size(); i++)
+    {
+        unsigned int idx = m->issueQueue[i].instr - m->instructions;
+        oldest = min(oldest, idx);
+        sig.push_back(idx - base);
+        sig.push_back(m->issueQueue[i].src1_ready | m->issueQueue[i].src2_ready << 1);
+        sig.push_back(canonReg(names, &next, m->issueQueue[i].instr->op1_r));
+        sig.push_back(canonReg(names, &next, m->issueQueue[i].instr->op2_r));
+        sig.push_back(canonReg(names, &next, m->issueQueue[i].instr->op3_r));
+    }
+
+    sig.push_back(m->reorderBuff.size());
+    for (int i = 0; i < m->reorderBuff.size(); i++)
+    {
+        unsigned int idx = m->reorderBuff[i]->instr - m->instructions;
+        oldest = min(oldest, idx);
+        sig.push_back(idx - base);
+        sig.push_back(m->reorderBuff[i]->ready | (i > 0 && m->reorderBuff[i] == m->reorderBuff[i - 1]) << 1);
+        sig.push_back(canonReg(names, &next, m->reorderBuff[i]->instr->op1_r));
+    }
+
+    sig.push_back(m->wBQueue.size());
+    for (int i = 0; i < m->wBQueue.size(); i++)
+    {
+        unsigned int idx = m->wBQueue[i] - m->instructions;
+        oldest = min(oldest, idx);
+        sig.push_back(idx - base);
+        sig.push_back(canonReg(names, &next, m->wBQueue[i]->op1_r));
+    }
+
+    // Rename only ever reads the front of the free list:
+    sig.push_back(min(m->freeList.size(), (size_t)freeCap));
+    for (int i = 0; i < m->freeList.size() && i < freeCap; i++)
+        sig.push_back(canonReg(names, &next, m->freeList[i]));
+
+    return oldest;
+}
+
+/**
+ * @brief Jumps the machine forward by whole repetitions of the stretch between two matching loop boundaries. Every stamp
+ * recorded between the snapshot and now is copied onto the instructions iterations later, and everything in flight is
+ * moved forward by the same number of instructions.
+ *
+ * @param m Machine to fast-forward, sitting at the later boundary
+ * @param snap Earlier boundary with the same projection
+ * @param shift Instructions between the two boundaries
+ * @param reps Number of repetitions to skip
+ */
+void extrapolate(machine_t *m, const loopSnapshot_t *snap, unsigned int shift, unsigned int reps)
+{
+    const unsigned int delta = m->cycle - snap->cycle; //!< Cycles per repetition
+    const unsigned int lo = snap->oldest;             //!< First instruction that may have a stamp in the window
+    const unsigned int hi = m->fetchOffset;           //!< One past the last instruction fetched so far
+    iRecord_t *window = (iRecord_t *)malloc((hi - lo) * sizeof(iRecord_t));
+
+    // Replay from a copy, the targets can overlap the source range when the loop body is short:
+    memcpy(window, m->instructions + lo, (hi - lo) * sizeof(iRecord_t));
+    for (unsigned int r = 1; r <= reps; r++)
+    {
+        for (unsigned int y = lo; y < hi; y++)
+        {
+            iRecord_t *target = &m->instructions[y + r * shift];
+            for (int s = 0; s < 7; s++)
+            {
+                unsigned int stamp = window[y - lo].*stageStamps[s];
+                if (stamp > snap->cycle && stamp <= m->cycle)
+                    target->*stageStamps[s] = stamp + r * delta;
+            }
+        }
+    }
+
+    // Instructions that will be in flight take over the renamed registers of the ones they replace:
+    for (unsigned int y = lo; y < hi; y++)
+    {
+        iRecord_t *target = &m->instructions[y + reps * shift];
+        target->op1_r = window[y - lo].op1_r;
+        target->op2_r = window[y - lo].op2_r;
+        target->op3_r = window[y - lo].op3_r;
+        target->fetchIndex = window[y - lo].fetchIndex + reps * shift;
+    }
+    free(window);
+
+    const unsigned int offset = reps * shift;
+    for (int i = 0; i < m->issueWidth; i++)
+    {
+        iRecord_t **lane[] = {&m->pipe[i].F, &m->pipe[i].Dc, &m->pipe[i].R, &m->pipe[i].Di};
+        for (int s = 0; s < 4; s++)
+        {
+            if (*lane[s] != NOP)
+                *lane[s] += offset;
+        }
+    }
+    for (int i = 0; i < m->issueQueue.size(); i++)
+        m->issueQueue[i].instr += offset;
+    for (int i = 0; i < m->reorderBuff.size(); i++)
+    {
+        if (i == 0 || m->reorderBuff[i] != m->reorderBuff[i - 1]) // Lanes dispatched together share one entry
+            m->reorderBuff[i]->instr += offset;
+    }
+    for (int i = 0; i < m->wBQueue.size(); i++)
+        m->wBQueue[i] += offset;
+
+    m->fetchOffset += offset;
+    m->completedInsts += reps * (m->completedInsts - snap->completedInsts);
+    m->iqAge += reps * (m->iqAge - snap->iqAge);
+    m->cycle += reps * delta;
+}
+
+/**
+ * @brief Called at the end of every cycle in fast mode. Snapshots the machine at each loop iteration boundary and, once a
+ * boundary projects to the same state as an earlier one, fast-forwards as far as the loop and the run budget allow.
+ *
+ * @param m Machine being simulated
+ * @param ff Fast mode bookkeeping
+ */
+void steadyStateCheck(machine_t *m, fastForward_t *ff)
+{
+    if (m->completedInsts >= m->ICOUNT)
+        return;
+
+    // Move on to the loop fetch is in, if any:
+    while (ff->curLoop < ff->loops.size() && m->fetchOffset >= ff->loops[ff->curLoop].end)
+    {
+        ff->curLoop++;
+        ff->lastIteration = -1;
+        ff->history.clear();
+    }
+    if (ff->curLoop == ff->loops.size() || m->fetchOffset < ff->loops[ff->curLoop].start || m->cycle == 0)
+        return;
+
+    const loopRegion_t *loop = &ff->loops[ff->curLoop];
+    int iteration = (m->fetchOffset - loop->start) / loop->period;
+    if (iteration == ff->lastIteration)
+        return;
+    ff->lastIteration = iteration;
+
+    loopSnapshot_t snap;
+    snap.iteration = iteration;
+    snap.cycle = m->cycle;
+    snap.completedInsts = m->completedInsts;
+    snap.iqAge = m->iqAge;
+    snap.freeRegs = m->freeList.size();
+    // An iteration renames at most one register per instruction:
+    snap.oldest = projectState(m, loop->start + iteration * loop->period, loop->period, snap.signature);
+
+    for (int i = ff->history.size() - 1; i >= 0; i--)
+    {
+        const loopSnapshot_t *prev = &ff->history[i];
+        if (prev->signature != snap.signature || prev->oldest < loop->start || snap.freeRegs < prev->freeRegs)
+            continue;
+
+        const unsigned int shift = (iteration - prev->iteration) * loop->period;
+        const unsigned int delta = m->cycle - prev->cycle;
+        const unsigned int commits = m->completedInsts - prev->completedInsts;
+        unsigned int reps = (loop->end - m->fetchOffset) / shift;
+        if (theBudget.maxCycles)
+            reps = min(reps, (theBudget.maxCycles - m->cycle) / delta);
+        if (commits > 0)
+            reps = min(reps, (m->ICOUNT - 1 - m->completedInsts) / commits);
+        if (commits > 0 && theBudget.maxCommitted)
+            reps = m->completedInsts < theBudget.maxCommitted ? min(reps, (unsigned int)((theBudget.maxCommitted - 1 - m->completedInsts) / commits)) : 0;
+        noteProgress(m);
+        if (commits == 0 && theBudget.stallCycles) // The watchdog has to go off on the same cycle it would have
+            reps = min(reps, (m->lastProgress + theBudget.stallCycles - m->cycle) / delta);
+        if (reps == 0)
+            break;
+
+#ifdef DEBUG_MODE
+        printf("Steady state at cycle %u: skipping %u x %u cycles\n", m->cycle, reps, delta);
+#endif
+        if (m->pipeView != NULL)
+            streamPipeView(m);
+        extrapolate(m, prev, shift, reps);
+        if (m->pipeView != NULL)
+            skipPipeView(m, commits, delta);
+        if (commits > 0) // The loop commits on the same cycles of every iteration
+        {
+            m->lastProgress += reps * delta;
+            m->lastCommitted = m->completedInsts;
+        }
+        ff->skips++;
+        ff->skippedCycles += (unsigned long long)reps * delta;
+        ff->lastIteration = (m->fetchOffset - loop->start) / loop->period;
+        ff->history.clear();
+        return;
+    }
+
+    ff->history.push_back(snap);
+    if (ff->history.size() > LOOP_HISTORY)
+        ff->history.pop_front();
+}
+
+/**
+ * @brief Advances the machine by up to budget cycles, stopping early once every instruction has committed or the machine
+ * has halted. Can be called repeatedly to run a machine in slices.
+ *
+ * @param m Machine to simulate, as set up by initMachine()
+ * @param ff Steady-state bookkeeping as set up by runMachine(), NULL to simulate every cycle
+ * @param budget Most cycles to simulate
+ * @return unsigned int Cycles simulated
+ */
+unsigned int runCycles(machine_t *m, fastForward_t *ff, unsigned int budget)
+{
+    unsigned int ran = 0;
+    while (!m->halted && m->completedInsts < m->ICOUNT && ran < budget)
+    {
+        stepMachine(m);
+        ran++;
+        if (ff != NULL)
+            steadyStateCheck(m, ff);
+        if (!endCycle(m))
+            break;
+    }
+    return ran;
+}
+
+/**
+ * @brief Simulates the machine until every instruction has committed
+ *
+ * @param m Machine to simulate, as set up by initMachine()
+ * @param ff Steady-state bookkeeping to extrapolate through loops with, NULL to simulate every cycle
+ */
+void runMachine(machine_t *m, fastForward_t *ff)
+{
+#ifdef DEBUG_MODE
+    // Print instructions:
+    printf("INSTRUCTIONS TO BE PROCESSED:\n");
+    for (int i = 0; i < m->ICOUNT; i++)
+    {
+        printf("%c %d %d %d\n", m->instructions[i].iType, m->instructions[i].op1, m->instructions[i].op2, m->instructions[i].op3);
+    }
+    printf("==========================================\n");
+#endif
+    if (ff != NULL)
+    {
+        ff->loops = findLoops(m->instructions, m->ICOUNT);
+        ff->curLoop = 0;
+        ff->lastIteration = -1;
+        ff->history.clear();
+        ff->skips = 0;
+        ff->skippedCycles = 0;
+    }
+
+    runCycles(m, ff, UINT_MAX);
+}
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring of fixed-size slots
+ *
+ */
+template <typename T>
+struct spscRing_t
+{
+    T *slots;                                    //!< capacity * width elements
+    unsigned int capacity;                       //!< Slots in the ring, a power of two
+    unsigned int width;                          //!< Elements per slot
+    alignas(64) atomic<unsigned long long> head; //!< Next slot to read, only written by the consumer
+    alignas(64) atomic<unsigned long long> tail; //!< Next slot to write, only written by the producer
+};
+
+template <typename T>
+void ringInit(spscRing_t<T> *r, unsigned int capacity, unsigned int width)
+{
+    r->slots = (T *)calloc((size_t)capacity * width, sizeof(T));
+    r->capacity = capacity;
+    r->width = width;
+    r->head.store(0);
+    r->tail.store(0);
+}
+
+template <typename T>
+void ringFree(spscRing_t<T> *r)
+{
+    free(r->slots);
+    r->slots = NULL;
+}
+
+/**
+ * @brief Producer side: slot to fill next
+ *
+ * @return T* Slot of width elements, NULL if the ring is full
+ */
+template <typename T>
+T *ringWriteSlot(spscRing_t<T> *r)
+{
+    unsigned long long tail = r->tail.load(memory_order_relaxed);
+    if (tail - r->head.load(memory_order_acquire) == r->capacity)
+        return NULL;
+    return r->slots + (tail & (r->capacity - 1)) * r->width;
+}
+
+/**
+ * @brief Producer side: hands the slot from ringWriteSlot() to the consumer
+ */
+template <typename T>
+void ringPush(spscRing_t<T> *r)
+{
+    r->tail.store(r->tail.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+/**
+ * @brief Consumer side: oldest slot not consumed yet
+ *
+ * @return const T* Slot of width elements, NULL if the ring is empty
+ */
+template <typename T>
+const T *ringReadSlot(spscRing_t<T> *r)
+{
+    unsigned long long head = r->head.load(memory_order_relaxed);
+    if (head == r->tail.load(memory_order_acquire))
+        return NULL;
+    return r->slots + (head & (r->capacity - 1)) * r->width;
+}
+
+/**
+ * @brief Consumer side: gives the slot from ringReadSlot() back to the producer
+ */
+template <typename T>
+void ringPop(spscRing_t<T> *r)
+{
+    r->head.store(r->head.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+/**
+ * @brief A stamp the front end wrote, kept until the back end is known to reach that cycle
+ *
+ */
+typedef struct splitUndo_t
+{
+    unsigned int cycle;                //!< Front end cycle that wrote the stamp
+    iRecord_t *instr;                  //!< Instruction stamped
+    unsigned int iRecord_t::*stamp;    //!< Stamp written
+    unsigned int old;                  //!< Value before the front end wrote it
+} splitUndo_t;
+
+/**
+ * @brief Front end lanes and fetch position at the end of one front end cycle
+ *
+ */
+typedef struct splitFrontState_t
+{
+    unsigned int cycle;       //!< Front end cycle
+    unsigned int fetchOffset; //!< Next instruction to fetch
+    size_t lanes;             //!< Offset of the F and Dc lanes of the cycle in the lane log
+} splitFrontState_t;
+
+/**
+ * @brief Simulates the machine with the pipeline split over two threads. The front end thread runs fetch() and decode()
+ * ahead of the back end and hands each cycle's rename lanes over a ring; the back end thread runs commit() through rename()
+ * and sends the rename stall signal back over a second ring. Rename stays in the back end because it shares the free list,
+ * map table and ready table with commit() and dispatch() within a cycle.
+ *
+ * Since the back end only learns when to stop as it goes, the front end logs the stamps it writes and whatever it did past
+ * the back end's last cycle is rolled back at the end, leaving the machine exactly as runMachine() would.
+ *
+ * @param m Machine to simulate, as set up by initMachine()
+ */
+void runSplit(machine_t *m)
+{
+    const unsigned int width = m->issueWidth;
+    const unsigned int start = m->cycle;
+    spscRing_t<iRecord_t *> bundles; //!< Rename lanes after each front end cycle
+    spscRing_t<unsigned int> stalls; //!< Rename stall signal after each back end cycle
+    atomic<bool> stop(false);
+    atomic<unsigned int> backCycle(start); //!< Cycle the back end is working on
+    deque<splitUndo_t> undoLog;
+    deque<splitFrontState_t> frontLog;
+    deque<iRecord_t *> laneLog;
+    size_t laneBase = 0; // Lane log entries already trimmed
+
+    ringInit(&bundles, SPLIT_RING_SLOTS, width);
+    ringInit(&stalls, SPLIT_RING_SLOTS, 1);
+
+    // The front end works on its own lanes over the shared instruction memory:
+    machine_t front;
+    front.issueWidth = width;
+    front.ICOUNT = m->ICOUNT;
+    front.instructions = m->instructions;
+    front.fetchOffset = m->fetchOffset;
+    front.profile = NULL;
+    front.pipe = (frontEndPipe_t *)malloc(width * sizeof(frontEndPipe_t));
+    front.decodeCopies = (iRecord_t *)malloc(width * sizeof(iRecord_t));
+    memcpy(front.pipe, m->pipe, width * sizeof(frontEndPipe_t));
+
+    thread frontEnd([&]() {
+        unsigned int stall = false;
+        for (unsigned int cycle = start;; cycle++)
+        {
+            iRecord_t **slot;
+            while ((slot = ringWriteSlot(&bundles)) == NULL)
+            {
+                if (stop.load(memory_order_acquire))
+                    return;
+                this_thread::yield();
+            }
+            const unsigned int *backStall;
+            while ((backStall = ringReadSlot(&stalls)) != NULL)
+            {
+                stall = *backStall;
+                ringPop(&stalls);
+            }
+
+            // Forget what the back end is already past:
+            unsigned int done = backCycle.load(memory_order_acquire);
+            while (!undoLog.empty() && undoLog.front().cycle < done)
+                undoLog.pop_front();
+            while (frontLog.size() > 1 && frontLog[1].cycle < done)
+            {
+                frontLog.pop_front();
+                laneBase += 2 * width;
+                laneLog.erase(laneLog.begin(), laneLog.begin() + 2 * width);
+            }
+
+            for (int i = 0; i < width; i++)
+            {
+                if (front.pipe[i].Dc != NOP)
+                    undoLog.push_back({cycle, front.pipe[i].Dc, &iRecord_t::Dc, front.pipe[i].Dc->Dc});
+                if (front.pipe[i].F != NOP)
+                    undoLog.push_back({cycle, front.pipe[i].F, &iRecord_t::F, front.pipe[i].F->F});
+            }
+            front.cycle = cycle;
+            front.stall = stall;
+            stepFrontEnd(&front);
+            stall = front.stall;
+
+            frontLog.push_back({cycle, front.fetchOffset, laneBase + laneLog.size()});
+            for (int i = 0; i < width; i++)
+            {
+                laneLog.push_back(front.pipe[i].F);
+                laneLog.push_back(front.pipe[i].Dc);
+                slot[i] = front.pipe[i].R;
+            }
+            ringPush(&bundles);
+
+            if (theBudget.maxCycles && cycle >= theBudget.maxCycles) // The back end never runs past this
+                return;
+        }
+    });
+
+    while (!m->halted && m->completedInsts < m->ICOUNT)
+    {
+        stepBackEnd(m);
+
+        if (m->cycle > start) // Rename takes what decode left it last cycle
+        {
+            iRecord_t *const *slot;
+            while ((slot = ringReadSlot(&bundles)) == NULL)
+                this_thread::yield();
+            for (int i = 0; i < width; i++)
+                m->pipe[i].R = slot[i];
+            ringPop(&bundles);
+        }
+        stepRename(m);
+
+        unsigned int *slot;
+        while ((slot = ringWriteSlot(&stalls)) == NULL)
+            this_thread::yield();
+        *slot = m->stall;
+        ringPush(&stalls);
+
+        if (!endCycle(m))
+            break;
+        backCycle.store(m->cycle, memory_order_release);
+    }
+    stop.store(true, memory_order_release);
+    frontEnd.join();
+
+    // Roll the front end back to the last cycle the back end ran:
+    const unsigned int last = m->halted ? m->cycle : m->cycle - 1;
+    while (!undoLog.empty() && undoLog.back().cycle > last)
+    {
+        undoLog.back().instr->*undoLog.back().stamp = undoLog.back().old;
+        undoLog.pop_back();
+    }
+    for (int k = 0; k < frontLog.size(); k++)
+    {
+        if (frontLog[k].cycle != last)
+            continue;
+        m->fetchOffset = frontLog[k].fetchOffset;
+        for (int i = 0; i < width; i++)
+        {
+            m->pipe[i].F = laneLog[frontLog[k].lanes - laneBase + 2 * i];
+            m->pipe[i].Dc = laneLog[frontLog[k].lanes - laneBase + 2 * i + 1];
+        }
+    }
+    m->stall = 0; // What decode() hands fetch()
+
+    free(front.pipe);
+    free(front.decodeCopies);
+    ringFree(&bundles);
+    ringFree(&stalls);
+}
+
+/**
+ * @brief Compares the records and final state of two machines that simulated the same trace
+ *
+ * @return unsigned int Number of instructions whose records differ
+ */
+unsigned int compareMachines(const machine_t *a, const machine_t *b)
+{
+    unsigned int diffs = 0;
+    for (int i = 0; i < a->ICOUNT; i++)
+    {
+        bool same = a->instructions[i].op1_r == b->instructions[i].op1_r && a->instructions[i].op2_r == b->instructions[i].op2_r &&
+                    a->instructions[i].op3_r == b->instructions[i].op3_r;
+        for (int s = 0; s < 7; s++)
+            same &= a->instructions[i].*stageStamps[s] == b->instructions[i].*stageStamps[s];
+        if (!same)
+            diffs++;
+    }
+    return diffs;
+}
+
+/**
+ * @brief Upper bound on the IPC of one configuration, from what this engine does rather than from the trace's dataflow.
+ * Fetch never stalls, so fetch group k is stamped F on cycle k. Rename lets an instruction through unrenamed when the free
+ * list is empty and commit puts a register back for every instruction, so registers never hold the pipeline back. The
+ * lanes of a group share one ROB entry, and a writeback to the same physical register can mark that entry ready on the
+ * cycle after dispatch, so dependences do not hold it back either: the critical path of the trace is no lower bound on
+ * cycles here, and neither is its register pressure. What is left is the width: group k commits no earlier than cycle
+ * k + FIRST_COMMIT_CYCLES, and the run ends the cycle after the last group commits.
+ *
+ * @param icount Instructions in the trace
+ * @param issueWidth Machine width
+ * @param pregCount Number of physical registers
+ * @return double Highest IPC the configuration could reach on the trace, 0 for a configuration that writes no records
+ */
+double ipcBound(unsigned int icount, unsigned int issueWidth, unsigned int pregCount)
+{
+    if (icount == 0)
+        return 0.0;
+    if (issueWidth < 1 || pregCount < AREG_COUNT)
+        return 0.0;
+
+    unsigned long long groups = ((unsigned long long)icount + issueWidth - 1) / issueWidth;
+    return (double)icount / (groups + FIRST_COMMIT_CYCLES);
+}
+
+/**
+ * @brief Prints the per-width IPC limits for the trace
+ *
+ * @param icount Instructions in the trace
+ * @param issueWidth Configured machine width
+ * @param pregCount Configured number of physical registers
+ */
+void printBounds(unsigned int icount, unsigned int issueWidth, unsigned int pregCount)
+{
+    printf("IPC bounds over %u instructions:\n", icount);
+    printf("  width  IPC <= (%u pregs)\n", pregCount);
+    for (unsigned int w = 1; w <= max(issueWidth, (unsigned int)BOUND_MAX_WIDTH); w++)
+        printf("  %5u  %.3f%s\n", w, ipcBound(icount, w, pregCount), w == issueWidth ? "  <- configured" : "");
+}
+
+/**
+ * @brief Checks ipcBound() against the engine: simulates every configuration to the end and compares its IPC with the
+ * bound. Runs the watchdog or another budget stopped are listed but cannot be held to a bound on the whole trace.
+ *
+ * @param t Trace to simulate
+ * @param widths Issue widths to check
+ * @param pregs Physical register counts to check
+ * @return int Number of configurations that beat their bound
+ */
+int checkBounds(const trace_t *t, const vector<unsigned int> &widths, const vector<unsigned int> &pregs)
+{
+    int violations = 0;
+    printf("Bound check over %u instructions:\n", t->count);
+    printf("  width  pregs     cycles   IPC    bound\n");
+    for (int w = 0; w < widths.size(); w++)
+    {
+        for (int p = 0; p < pregs.size(); p++)
+        {
+            if (widths[w] < 1 || pregs[p] < AREG_COUNT) // No records to hold to a bound
+                continue;
+            machine_t m;
+            initMachine(&m, t, widths[w], pregs[p]);
+            runMachine(&m, NULL);
+            double ipc = m.cycle ? (double)m.completedInsts / m.cycle : 0.0;
+            double bound = ipcBound(t->count, widths[w], pregs[p]);
+            const char *verdict = "ok";
+            if (m.completedInsts < m.ICOUNT)
+                verdict = haltNames[m.haltReason];
+            else if (ipc > bound + 1e-9)
+            {
+                verdict = "VIOLATED";
+                violations++;
+            }
+            printf("  %5u  %5u  %9u  %5.3f  %5.3f  %s\n", widths[w], pregs[p], m.cycle, ipc, bound, verdict);
+            freeMachine(&m);
+        }
+    }
+    return violations;
+}
+
+/**
+ * @brief Where a configuration stands in exploreDesignSpace()
+ *
+ */
+typedef enum dseState_t
+{
+    DSE_RUNNING,   //!< Still a close call, keeps being simulated
+    DSE_PASS,      //!< Reaches the target IPC
+    DSE_FAIL,      //!< Cannot reach the target IPC
+    DSE_DOMINATED, //!< Settled by a smaller configuration that passes, so it cannot be on the frontier
+    DSE_HALTED,    //!< Stopped by the run budget or the watchdog before a verdict, the IPC is only known to be in range
+} dseState_t;
+
+/**
+ * @brief One configuration of the design space under exploration
+ *
+ */
+typedef struct dseCandidate_t
+{
+    unsigned int issueWidth; //!< Machine width
+    unsigned int pregCount;  //!< Number of physical registers
+    machine_t m;             //!< Machine being simulated, initialized once the candidate first runs
+    bool started;            //!< Set once m was initialized
+    dseState_t state;        //!< Verdict so far
+    const char *reason;      //!< What settled the verdict
+    double bound;            //!< Upper bound on the IPC from ipcBound()
+    double ipcLo, ipcHi;     //!< Running bounds on the final IPC
+    unsigned int samples;    //!< Slices simulated so far
+    double rateSum;          //!< Sum of the commit rates of the slices
+    double rateSqSum;        //!< Sum of the squared commit rates of the slices
+} dseCandidate_t;
+
+/**
+ * @brief Splits a comma separated list of numbers
+ *
+ * @param arg List to parse
+ * @param out Receives the numbers
+ */
+void parseList(const char *arg, vector<unsigned int> &out)
+{
+    char *end;
+    out.clear();
+    while (*arg != '\0')
+    {
+        out.push_back(strtoul(arg, &end, 10));
+        if (end == arg)
+            break;
+        arg = *end == ',' ? end + 1 : end;
+    }
+}
+
+/**
+ * @brief Narrows the bounds on the final IPC of a candidate after another slice of simulation. Machines that committed the
+ * whole trace are exact. Otherwise the instructions still to commit can go no faster than the width allows, and are expected
+ * to go at the commit rate seen so far, give or take DSE_CONFIDENCE_Z standard errors. A halted machine keeps the range it
+ * had: nothing says how it would have gone on.
+ *
+ * @param c Candidate to update
+ * @param ran Cycles simulated in the last slice
+ * @param commits Instructions committed in the last slice
+ */
+void updateIpcBounds(dseCandidate_t *c, unsigned int ran, unsigned int commits)
+{
+    const machine_t *m = &c->m;
+    const double total = m->ICOUNT;
+
+    if (m->completedInsts >= m->ICOUNT)
+    {
+        c->ipcLo = c->ipcHi = m->cycle ? m->completedInsts / (double)m->cycle : 0.0;
+        return;
+    }
+
+    if (ran > 0)
+    {
+        double rate = commits / (double)ran;
+        c->samples++;
+        c->rateSum += rate;
+        c->rateSqSum += rate * rate;
+    }
+
+    // The bound holds for the whole trace, not for what is left of it, so only the width limits the remaining commits
+    const double remaining = total - m->completedInsts;
+    const double peak = c->issueWidth;
+    c->ipcHi = min(c->bound, total / (m->cycle + remaining / peak));
+    c->ipcLo = 0.0;
+    if (c->samples < DSE_MIN_SAMPLES || m->halted)
+        return;
+
+    const double mean = c->rateSum / c->samples;
+    const double var = max(0.0, c->rateSqSum / c->samples - mean * mean);
+    const double err = DSE_CONFIDENCE_Z * sqrt(var / c->samples);
+    if (mean + err < peak)
+        c->ipcHi = min(c->ipcHi, total / (m->cycle + remaining / (mean + err)));
+    if (mean - err > 0.0)
+        c->ipcLo = min(c->ipcHi, total / (m->cycle + remaining / (mean - err)));
+}
+
+/**
+ * @brief Settles every running configuration larger than one that just passed. Whatever they would reach, the smaller one
+ * keeps them off the frontier. Failures and halts settle nothing: this engine can run slower, or stall, with more
+ * registers, so a larger configuration failing says nothing about a smaller one.
+ *
+ * @param cands Candidates under exploration
+ * @param settled Index of the candidate that just passed
+ */
+void settleDominated(vector<dseCandidate_t> &cands, int settled)
+{
+    const dseCandidate_t *s = &cands[settled];
+    for (int j = 0; j < cands.size(); j++)
+    {
+        dseCandidate_t *c = &cands[j];
+        if (c->state != DSE_RUNNING)
+            continue;
+        if (c->issueWidth >= s->issueWidth && c->pregCount >= s->pregCount)
+        {
+            c->state = DSE_DOMINATED;
+            c->reason = "smaller config passes";
+        }
+    }
+}
+
+/**
+ * @brief Searches a grid of widths and physical register counts for the smallest configurations that reach a target IPC.
+ * Every configuration is simulated in slices of chunkCycles, and one is only kept running while its IPC bounds straddle the
+ * target. A configuration that passes settles every larger one, which it keeps off the frontier. Nothing is assumed about
+ * smaller ones: a failure or a halt only settles the configuration itself. Configurations whose bound is below the target
+ * are never simulated, so every one that does finish is checked against its bound and a violation voids the exploration.
+ *
+ * @param widths Issue widths to explore
+ * @param pregs Physical register counts to explore
+ * @param targetIpc IPC a configuration has to reach
+ * @param chunkCycles Cycles each running configuration is simulated between decisions
+ * @return Number of configurations that beat their IPC bound
+ */
+int exploreDesignSpace(const vector<unsigned int> &widths, const vector<unsigned int> &pregs, double targetIpc, unsigned int chunkCycles)
+{
+    vector<dseCandidate_t> cands(widths.size() * pregs.size());
+    for (int w = 0; w < widths.size(); w++)
+    {
+        for (int p = 0; p < pregs.size(); p++)
+        {
+            dseCandidate_t *c = &cands[w * pregs.size() + p];
+            c->issueWidth = widths[w];
+            c->pregCount = pregs[p];
+            c->started = false;
+            c->samples = 0;
+            c->rateSum = c->rateSqSum = 0.0;
+            c->bound = ipcBound(theTrace.count, c->issueWidth, c->pregCount);
+            c->ipcLo = 0.0;
+            c->ipcHi = c->bound;
+            c->state = DSE_RUNNING;
+            c->reason = "";
+            if (c->bound < targetIpc)
+            {
+                c->state = DSE_FAIL;
+                c->reason = "IPC bound";
+            }
+        }
+    }
+
+    unsigned long long simulated = 0; //!< Cycles simulated over all configurations
+    unsigned int rounds = 0;
+    int violations = 0;
+    bool running = true;
+    while (running)
+    {
+        running = false;
+        rounds++;
+        for (int i = 0; i < cands.size(); i++)
+        {
+            dseCandidate_t *c = &cands[i];
+            if (c->state != DSE_RUNNING)
+                continue;
+            if (!c->started)
+            {
+                initMachine(&c->m, &theTrace, c->issueWidth, c->pregCount);
+                c->started = true;
+            }
+
+            unsigned int committed = c->m.completedInsts;
+            unsigned int ran = runCycles(&c->m, NULL, chunkCycles);
+            simulated += ran;
+            updateIpcBounds(c, ran, c->m.completedInsts - committed);
+
+            bool finished = c->m.completedInsts >= c->m.ICOUNT; //!< Halting never finishes, so a halted machine has no verdict
+            if (finished && c->ipcLo > c->bound)
+            {
+                fprintf(stderr, "Width %u with %u pregs ran at IPC %.3f, above its bound %.3f\n", c->issueWidth, c->pregCount, c->ipcLo,
+                        c->bound);
+                violations++;
+            }
+            if (c->m.halted)
+            {
+                c->state = DSE_HALTED;
+                c->reason = haltNames[c->m.haltReason];
+            }
+            else if (c->ipcLo >= targetIpc)
+            {
+                c->state = DSE_PASS;
+                c->reason = finished ? "simulated" : "confident";
+                settleDominated(cands, i);
+            }
+            else if (c->ipcHi < targetIpc)
+            {
+                c->state = DSE_FAIL;
+                c->reason = finished ? "simulated" : "confident";
+            }
+        }
+
+        for (int i = 0; i < cands.size(); i++)
+            running |= cands[i].state == DSE_RUNNING;
+    }
+
+    const char *stateNames[] = {"running", "pass", "fail", "dominated", "halted"};
+    printf("Design space exploration for IPC >= %.3f, %u cycle slices, %u rounds:\n", targetIpc, chunkCycles, rounds);
+    printf("  width  pregs  state      IPC range        cycles  reason\n");
+    for (int i = 0; i < cands.size(); i++)
+    {
+        dseCandidate_t *c = &cands[i];
+        assert(c->ipcLo <= c->ipcHi);
+        printf("  %5u  %5u  %-9s  %6.3f..%-6.3f  %7u  %s\n", c->issueWidth, c->pregCount, stateNames[c->state], c->ipcLo, c->ipcHi,
+               c->started ? c->m.cycle : 0, c->reason);
+    }
+
+    printf("Pareto frontier:");
+    bool any = false;
+    for (int i = 0; i < cands.size(); i++)
+    {
+        if (cands[i].state != DSE_PASS)
+            continue;
+        bool dominated = false;
+        for (int j = 0; j < cands.size(); j++)
+        {
+            if (j != i && cands[j].state == DSE_PASS && cands[j].issueWidth <= cands[i].issueWidth && cands[j].pregCount <= cands[i].pregCount &&
+                (cands[j].issueWidth < cands[i].issueWidth || cands[j].pregCount < cands[i].pregCount))
+                dominated = true;
+        }
+        if (!dominated)
+        {
+            printf(" (width %u, %u pregs)", cands[i].issueWidth, cands[i].pregCount);
+            any = true;
+        }
+    }
+    printf("%s\n", any ? "" : " none");
+    printf("Simulated %llu cycles over %lu configurations\n", simulated, cands.size());
+
+    for (int i = 0; i < cands.size(); i++)
+    {
+        if (cands[i].started)
+            freeMachine(&cands[i].m);
+    }
+    if (violations)
+        printf("%d configurations beat their IPC bound, the verdicts it settled cannot be trusted\n", violations);
+    return violations;
+}
+
+/**
+ * @brief Prints how far the fast mode strayed from exact simulation of the same trace
+ *
+ * @param exact Machine simulated cycle by cycle
+ * @param fast Machine simulated in fast mode
+ * @param ff Fast mode bookkeeping of the fast machine
+ * @param exactSec Wall time of the exact run
+ * @param fastSec Wall time of the fast run
+ */
+void fastModeReport(const machine_t *exact, const machine_t *fast, const fastForward_t *ff, double exactSec, double fastSec)
+{
+    unsigned long long stamps = 0, wrong = 0, absErr = 0;
+    unsigned int maxErr = 0;
+    for (int i = 0; i < exact->ICOUNT; i++)
+    {
+        for (int s = 0; s < 7; s++)
+        {
+            unsigned int a = exact->instructions[i].*stageStamps[s];
+            unsigned int b = fast->instructions[i].*stageStamps[s];
+            unsigned int err = a > b ? a - b : b - a;
+            stamps++;
+            if (err != 0)
+            {
+                wrong++;
+                absErr += err;
+                maxErr = max(maxErr, err);
+            }
+        }
+    }
+
+    printf("Fast mode: %lu loops, %u skips, %llu of %u cycles extrapolated\n", ff->loops.size(), ff->skips, ff->skippedCycles, fast->cycle);
+    printf("  exact: %u cycles, %u committed, %.3f s\n", exact->cycle, exact->completedInsts, exactSec);
+    printf("  fast:  %u cycles, %u committed, %.3f s\n", fast->cycle, fast->completedInsts, fastSec);
+    printf("  stamps off: %llu of %llu, mean error %.3f cycles, max error %u cycles\n", wrong, stamps, stamps ? (double)absErr / stamps : 0.0, maxErr);
+}
+
+/**
+ * @brief One trace of a batch run and what became of it
+ *
+ */
+typedef struct batchJob_t
+{
+    string path;              //!< Trace file
+    string outName;           //!< Records file in the output directory, unique within the batch
+    unsigned long long bytes; //!< Size of the trace file, long traces are started first
+    bool ok;                  //!< Set once the trace was simulated
+    unsigned int instrs;      //!< Instructions in the trace
+    unsigned int issueWidth;  //!< Machine width it ran with
+    unsigned int pregCount;   //!< Physical registers it ran with
+    unsigned int cycles;      //!< Cycle the simulation stopped at
+    unsigned int committed;   //!< Instructions committed
+    haltReason_t haltReason;  //!< Why the simulation stopped before committing every instruction, HALT_NONE if it did not
+    double seconds;           //!< Wall time of the simulation
+} batchJob_t;
+
+/**
+ * @brief Queue of one batch worker. Its owner and the workers stealing from it both take from the front, so the longest
+ * trace left is always the next to start.
+ *
+ */
+typedef struct batchQueue_t
+{
+    mutex lock;           //!< Guards jobs
+    deque<size_t> jobs;   //!< Indices of the jobs left, longest first
+} batchQueue_t;
+
+/**
+ * @brief Takes the next job for a worker, from its own queue first and then from the others
+ *
+ * @param queues Queues of all workers
+ * @param nQueues Number of workers
+ * @param self Worker asking
+ * @param job Receives the job index
+ * @return true if a job was found
+ */
+bool nextBatchJob(batchQueue_t *queues, unsigned int nQueues, unsigned int self, size_t *job)
+{
+    for (unsigned int k = 0; k < nQueues; k++)
+    {
+        batchQueue_t *q = &queues[(self + k) % nQueues];
+        lock_guard<mutex> hold(q->lock);
+        if (!q->jobs.empty())
+        {
+            *job = q->jobs.front();
+            q->jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Collects the traces of a batch: every regular file of a directory, or every line of a manifest file. Each trace
+ * writes its records to <trace>.out; traces of a manifest that share a file name get <trace>#<line>.out instead, with
+ * their position in the manifest, so no two workers write the same file.
+ *
+ * @param source Directory or manifest
+ * @param jobs Receives one job per trace
+ * @return true if the source could be read
+ */
+bool collectBatch(const char *source, vector<batchJob_t> &jobs)
+{
+    struct stat st;
+    if (stat(source, &st) != 0)
+    {
+        perror("Error reading batch\n");
+        return false;
+    }
+
+    vector<string> paths;
+    if (S_ISDIR(st.st_mode))
+    {
+        DIR *dir = opendir(source);
+        if (dir == NULL)
+        {
+            perror("Error reading batch\n");
+            return false;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL)
+        {
+            if (entry->d_name[0] != '.')
+                paths.push_back(string(source) + "/" + entry->d_name);
+        }
+        closedir(dir);
+        sort(paths.begin(), paths.end());
+    }
+    else
+    {
+        FILE *manifest = fopen(source, "r");
+        if (manifest == NULL)
+        {
+            perror("Error reading batch\n");
+            return false;
+        }
+        char lineBuff[4096];
+        while (fgets(lineBuff, sizeof(lineBuff), manifest))
+        {
+            lineBuff[strcspn(lineBuff, "\r\n")] = '\0';
+            if (lineBuff[0] != '\0' && lineBuff[0] != '#')
+                paths.push_back(lineBuff);
+        }
+        fclose(manifest);
+    }
+
+    const bool listed = !S_ISDIR(st.st_mode); // Listed traces are reported even if missing
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        bool found = stat(paths[i].c_str(), &st) == 0 && S_ISREG(st.st_mode);
+        if (!found && !listed)
+            continue;
+        batchJob_t job = {};
+        job.path = paths[i];
+        const char *base = strrchr(job.path.c_str(), '/');
+        job.outName = base ? base + 1 : job.path;
+        job.bytes = found ? st.st_size : 0;
+        jobs.push_back(job);
+    }
+
+    vector<size_t> byName(jobs.size());
+    for (size_t i = 0; i < byName.size(); i++)
+        byName[i] = i;
+    sort(byName.begin(), byName.end(), [&](size_t a, size_t b) { return jobs[a].outName < jobs[b].outName; });
+    vector<bool> shared(jobs.size(), false);
+    for (size_t i = 1; i < byName.size(); i++)
+    {
+        if (jobs[byName[i - 1]].outName == jobs[byName[i]].outName)
+            shared[byName[i - 1]] = shared[byName[i]] = true;
+    }
+    for (size_t i = 0; i < jobs.size(); i++)
+        jobs[i].outName += (shared[i] ? "#" + to_string(i + 1) : string()) + ".out";
+    return true;
+}
+
+/**
+ * @brief Simulates every trace of a batch on a pool of worker threads, each reusing one trace buffer and one machine for
+ * all the traces it runs. Writes the records of each trace to the file collectBatch() named for it in outDir, and a summary
+ * of all of them to outDir/summary.txt, which gives the cycle each trace stopped at and what stopped it.
+ *
+ * @param source Directory or manifest of traces
+ * @param outDir Directory for the outputs
+ * @param nWorkers Worker threads
+ * @param widthOverride Issue width to use for every trace, -1 for each trace header's
+ * @param pregOverride Physical register count to use for every trace, -1 for each trace header's
+ * @param fastMode Extrapolate through loops
+ * @return int Number of traces that could not be simulated, -1 if the batch could not be read
+ */
+int runBatch(const char *source, const char *outDir, unsigned int nWorkers, int widthOverride, int pregOverride, bool fastMode)
+{
+    vector<batchJob_t> jobs;
+    if (!collectBatch(source, jobs))
+        return -1;
+    if (mkdir(outDir, 0777) != 0 && errno != EEXIST)
+    {
+        perror("Error creating output directory\n");
+        return -1;
+    }
+
+    // Deal the traces out longest first so every worker starts on a long one:
+    vector<size_t> order(jobs.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return jobs[a].bytes > jobs[b].bytes; });
+
+    nWorkers = max(1u, min(nWorkers, (unsigned int)jobs.size()));
+    batchQueue_t *queues = new batchQueue_t[nWorkers];
+    for (size_t i = 0; i < order.size(); i++)
+        queues[i % nWorkers].jobs.push_back(order[i]);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (unsigned int w = 0; w < nWorkers; w++)
+    {
+        workers.push_back(thread([&, w]() {
+            trace_t trace = {NULL, 0, 0, 0, 0};
+            machine_t m;
+            fastForward_t ff;
+            bool fresh = true;
+            size_t j;
+
+            while (nextBatchJob(queues, nWorkers, w, &j))
+            {
+                batchJob_t *job = &jobs[j];
+                chrono::steady_clock::time_point jobStart = chrono::steady_clock::now();
+                if (loadTrace(job->path.c_str(), &trace) < 0)
+                    continue;
+
+                job->instrs = trace.count;
+                job->issueWidth = widthOverride >= 0 ? widthOverride : trace.issueWidth;
+                job->pregCount = pregOverride >= 0 ? pregOverride : trace.pregCount;
+                if (fresh)
+                    initMachine(&m, &trace, job->issueWidth, job->pregCount);
+                else
+                    resetMachine(&m, &trace, job->issueWidth, job->pregCount);
+                fresh = false;
+
+                runMachine(&m, fastMode ? &ff : NULL);
+                printRecords(&m, (string(outDir) + "/" + job->outName).c_str());
+
+                job->cycles = m.cycle;
+                job->committed = m.completedInsts;
+                job->haltReason = m.haltReason;
+                job->seconds = chrono::duration<double>(chrono::steady_clock::now() - jobStart).count();
+                job->ok = true;
+            }
+
+            if (!fresh)
+                freeMachine(&m);
+            freeTrace(&trace);
+        }));
+    }
+    for (unsigned int w = 0; w < nWorkers; w++)
+        workers[w].join();
+    delete[] queues;
+    double wallSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // Summary in manifest order:
+    string summaryPath = string(outDir) + "/summary.txt";
+    FILE *summary = fopen(summaryPath.c_str(), "w");
+    if (summary == NULL)
+    {
+        perror("Error writing file\n");
+        return -1;
+    }
+    int failed = 0, halted = 0;
+    unsigned long long instrs = 0, cycles = 0, committed = 0;
+    double cpuSec = 0.0;
+    fprintf(summary, "trace, instructions, width, pregs, cycles, committed, IPC, seconds, stopped by\n");
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const batchJob_t *job = &jobs[i];
+        if (!job->ok)
+        {
+            fprintf(summary, "%s, failed\n", job->path.c_str());
+            failed++;
+            continue;
+        }
+        fprintf(summary, "%s, %u, %u, %u, %u, %u, %.3f, %.3f, %s\n", job->path.c_str(), job->instrs, job->issueWidth, job->pregCount, job->cycles,
+                job->committed, job->cycles ? (double)job->committed / job->cycles : 0.0, job->seconds, haltNames[job->haltReason]);
+        halted += job->haltReason != HALT_NONE;
+        instrs += job->instrs;
+        cycles += job->cycles;
+        committed += job->committed;
+        cpuSec += job->seconds;
+    }
+    fprintf(summary, "total, %llu, , , %llu, %llu, %.3f, %.3f, %d halted\n", instrs, cycles, committed, cycles ? (double)committed / cycles : 0.0, cpuSec,
+            halted);
+    fclose(summary);
+
+    printf("Batch: %lu traces (%d failed, %d halted) on %u workers in %.3f s, %.3f s of simulation\n", jobs.size(), failed, halted, nWorkers, wallSec,
+           cpuSec);
+    printf("  %llu instructions, %llu cycles, IPC %.3f. Summary in %s\n", instrs, cycles, cycles ? (double)committed / cycles : 0.0, summaryPath.c_str());
+    return failed;
+}
+
+/**
+ * @brief One physical register count simulated by runLockstep()
+ *
+ */
+typedef struct lockstepLane_t
+{
+    unsigned int pregCount; //!< Physical register count of this configuration
+    machine_t m;            //!< Own machine, once forked
+    bool forked;            //!< Whether m is in use. Otherwise the shared machine stands in for this lane
+    unsigned int forkCycle; //!< Cycle the lane left the shared machine, UINT_MAX if it never did
+} lockstepLane_t;
+
+/**
+ * @brief Simulates one trace on several physical register counts from a single load of the trace. Machines that differ
+ * only in their register count behave identically until the smallest one has renamed through the registers it started
+ * with on its free list: up to there the larger ones only differ by extra registers queued behind those. So one shared
+ * machine of the smallest count simulates for all of them up to that cycle. Then every larger count forks a copy with its
+ * extra registers put in place, and each lane runs to the end on its own.
+ *
+ * @param t Trace to simulate
+ * @param issueWidth Issue width of every configuration
+ * @param pregs Physical register counts to simulate
+ * @param inFile Trace file, for check to load again per configuration
+ * @param loadSec Time the one load of t took
+ * @param outFile Each configuration's records go to outFile.<pregs>
+ * @param check Also load and simulate each configuration on its own, and compare
+ * @return int Number of configurations whose records differ from their own simulation, -1 if the trace could not be loaded
+ */
+int runLockstep(const trace_t *t, unsigned int issueWidth, const vector<unsigned int> &pregs, const char *inFile, double loadSec, const char *outFile,
+                bool check)
+{
+    vector<lockstepLane_t> lanes(pregs.size()); // Sized once, machines must not move
+    unsigned int leaderPregs = UINT_MAX;
+    machine_t leader; //!< Shared machine of the smallest register count
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for (size_t k = 0; k < lanes.size(); k++)
+    {
+        lanes[k].pregCount = pregs[k];
+        lanes[k].forked = false;
+        lanes[k].forkCycle = UINT_MAX;
+        if (pregs[k] >= AREG_COUNT) // Fewer cannot even map the architectural registers
+            leaderPregs = min(leaderPregs, pregs[k]);
+    }
+    if (leaderPregs == UINT_MAX)
+    {
+        printf("Lockstep: every register count is below %d\n", AREG_COUNT);
+        return 0;
+    }
+
+    // Rename takes at most one register per lane a cycle. Share the machine while it cannot run past its initial ones:
+    initMachine(&leader, t, issueWidth, leaderPregs);
+    unsigned int commonLeft = leaderPregs - AREG_COUNT; //!< Initial free registers still at the front of the shared free list
+    while (!leader.halted && leader.completedInsts < leader.ICOUNT && commonLeft >= leader.issueWidth)
+    {
+        size_t freeBefore = leader.freeList.size();
+        unsigned int committedBefore = leader.completedInsts;
+        runCycles(&leader, NULL, 1);
+        size_t taken = freeBefore + (leader.completedInsts - committedBefore) - leader.freeList.size();
+        commonLeft = taken > commonLeft ? 0 : commonLeft - taken;
+    }
+
+    const bool diverge = !leader.halted && leader.completedInsts < leader.ICOUNT;
+    for (size_t k = 0; k < lanes.size() && diverge; k++)
+    {
+        lockstepLane_t *lane = &lanes[k];
+        if (lane->pregCount <= leaderPregs)
+            continue;
+        machine_t *m = &lane->m;
+        cloneMachine(m, &leader);
+        m->pregCount = m->pregCapacity = lane->pregCount;
+        m->readyTable = (unsigned int *)realloc(m->readyTable, lane->pregCount * sizeof(unsigned int));
+        for (unsigned int p = leaderPregs; p < lane->pregCount; p++)
+        {
+            m->readyTable[p] = true;
+            m->freeList.insert(m->freeList.begin() + commonLeft + (p - leaderPregs), p); // Behind the initial ones, ahead of reclaimed ones
+        }
+        lane->forked = true;
+        lane->forkCycle = leader.cycle;
+    }
+
+    // Past the fork the lanes share nothing, so each runs to the end in one go rather than a cycle at a time in turn:
+    runCycles(&leader, NULL, UINT_MAX);
+    for (size_t k = 0; k < lanes.size(); k++)
+    {
+        if (lanes[k].forked)
+            runCycles(&lanes[k].m, NULL, UINT_MAX);
+    }
+    double runSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    int mismatches = 0;
+    double serialSec = 0.0;
+    printf("Lockstep: %lu configurations, width %u, %.3f s after a %.3f s load\n", lanes.size(), issueWidth, runSec, loadSec);
+    printf("  pregs  cycles  committed    IPC  forked%s\n", check ? "  check" : "");
+    for (size_t k = 0; k < lanes.size(); k++)
+    {
+        if (lanes[k].pregCount < AREG_COUNT)
+        {
+            printf("  %5u  needs at least %d physical registers\n", lanes[k].pregCount, AREG_COUNT);
+            continue;
+        }
+        const machine_t *m = lanes[k].forked ? &lanes[k].m : &leader;
+        char laneFile[PATH_MAX];
+        snprintf(laneFile, sizeof(laneFile), "%s.%u", outFile, lanes[k].pregCount);
+        printRecords(m, laneFile);
+
+        printf("  %5u  %6u  %9u  %5.3f  ", lanes[k].pregCount, m->cycle, m->completedInsts, m->cycle ? (double)m->completedInsts / m->cycle : 0.0);
+        if (lanes[k].forked)
+            printf("%6u", lanes[k].forkCycle);
+        else
+            printf("%6s", "never");
+
+        if (check)
+        {
+            trace_t own = {NULL, 0, 0, 0, 0};
+            machine_t serialMachine;
+            chrono::steady_clock::time_point serialStart = chrono::steady_clock::now();
+            if (loadTrace(inFile, &own) < 0)
+                return -1;
+            initMachine(&serialMachine, &own, issueWidth, lanes[k].pregCount);
+            runMachine(&serialMachine, NULL);
+            serialSec += chrono::duration<double>(chrono::steady_clock::now() - serialStart).count();
+            unsigned int diffs = compareMachines(&serialMachine, m);
+            if (diffs || serialMachine.cycle != m->cycle)
+            {
+                printf("  %u of %u records differ", diffs, m->ICOUNT);
+                mismatches++;
+            }
+            else
+                printf("  exact");
+            freeMachine(&serialMachine);
+            freeTrace(&own);
+        }
+        printf("\n");
+    }
+    if (check)
+        printf("  separate runs: %.3f s\n  lockstep:      %.3f s (%.2fx), both with their loads\n", serialSec, loadSec + runSec,
+               serialSec / (loadSec + runSec));
+
+    for (size_t k = 0; k < lanes.size(); k++)
+    {
+        if (lanes[k].forked)
+            freeMachine(&lanes[k].m);
+    }
+    freeMachine(&leader);
+    return mismatches;
+}
+
+/**
+ * @brief Issue queue entry of a machineSnapshot_t, with the instruction as a reference from snapRef()
+ *
+ */
+typedef struct snapIqEntry_t
+{
+    int instr;        //!< Instruction of the entry
+    bool src1_ready;  //!< op2_r ready
+    bool src2_ready;  //!< op3_r ready
+    unsigned int age; //!< Age of the entry, relative to iqAge of the snapshot
+} snapIqEntry_t;
+
+/**
+ * @brief ROB pool entry of a machineSnapshot_t, with the instruction as a reference from snapRef()
+ *
+ */
+typedef struct snapRobEntry_t
+{
+    int instr;      //!< Instruction of the entry
+    bool ready;     //!< Marked in writeback
+    bool committed; //!< Committed flag
+} snapRobEntry_t;
+
+/**
+ * @brief Compact copy of a machine at the start of a cycle. Only the records the stages can still reach are kept, everything
+ * older is final and can be taken from the end of the run. The commit queue and the IS, W and C lanes are only ever written,
+ * so the commit queue is left out and the lanes do not hold records back. The free list, which grows by a register for
+ * every commit, is not copied: rename takes from its front and commit adds to its back, so it is always a window of the
+ * log of every register put on it, which all snapshots of a run share.
+ *
+ */
+typedef struct machineSnapshot_t
+{
+    unsigned int cycle;            //!< Cycle about to be simulated
+    unsigned int completedInsts;   //!< Committed instructions
+    unsigned int sinceCommit;      //!< Cycles since the last commit, for the watchdog
+    unsigned int minFree;          //!< Fewest free registers at the end of any cycle from here to the end of the run
+    size_t freeHead;               //!< Front of the free list in the free log of the run
+    size_t pushIdx;                //!< End of the free list in the free log, where the next register put back goes
+    unsigned int fetchOffset;      //!< Next instruction to fetch
+    unsigned int stall;            //!< Stall signal out of rename
+    unsigned long long iqAge;      //!< IQ age tracker
+    unsigned int base;             //!< Oldest instruction the machine still references
+    vector<unsigned int> heldIdx;  //!< Instructions the machine still references, ascending
+    vector<iRecord_t> held;        //!< Records of heldIdx
+    vector<iRecord_t> decodeCopies; //!< Per-lane decode copies
+    unsigned int mapTable[AREG_COUNT];
+    vector<unsigned int> readyTable;
+    vector<int> lanes;             //!< F, Dc, R, Di, IS, W and C of every lane
+    vector<snapIqEntry_t> issueQueue;
+    vector<int> wBQueue;
+    vector<snapRobEntry_t> robPool;
+    vector<unsigned int> reorderBuff; //!< Indices into robPool
+} machineSnapshot_t;
+
+/**
+ * @brief Outcome of resimulate()
+ *
+ */
+typedef struct resimReport_t
+{
+    unsigned int firstDiff;      //!< First instruction that differs from the baseline
+    unsigned int resumeCycle;    //!< Cycle simulation resumed from
+    unsigned int convergeCycle;  //!< Cycle the machine matched a baseline snapshot, UINT_MAX if it never did
+    unsigned int convergeSnap;   //!< Baseline cycle it matched
+    unsigned int simulated;      //!< Cycles simulated
+} resimReport_t;
+
+iRecord_t *frontEndPipe_t::*const laneStages[] = {&frontEndPipe_t::F, &frontEndPipe_t::Dc, &frontEndPipe_t::R, &frontEndPipe_t::Di,
+                                                  &frontEndPipe_t::IS, &frontEndPipe_t::W, &frontEndPipe_t::C}; //!< Stages of a lane in pipeline order
+
+/**
+ * @brief Turns a pointer into a machine into something that survives a copy of the machine
+ *
+ * @return int Index into instruction memory, -1 for a NOP, -2 - lane for a decode copy
+ */
+int snapRef(const machine_t *m, const iRecord_t *p)
+{
+    if (p == NOP)
+        return -1;
+    if (p >= m->decodeCopies && p < m->decodeCopies + m->issueWidth)
+        return -2 - (int)(p - m->decodeCopies);
+    return p - m->instructions;
+}
+
+/**
+ * @brief Inverse of snapRef()
+ *
+ * @param shift Instructions to move an index into instruction memory by
+ */
+iRecord_t *unsnapRef(machine_t *m, int ref, int shift)
+{
+    if (ref == -1)
+        return NOP;
+    if (ref < -1)
+        return m->decodeCopies + (-2 - ref);
+    return m->instructions + ref + shift;
+}
+
+/**
+ * @brief Index in instruction memory of a reference from snapRef(), moved by shift. Other references stay as they are
+ *
+ */
+int shiftRef(int ref, int shift)
+{
+    return ref >= 0 ? ref + shift : ref;
+}
+
+/**
+ * @brief Copies the state of a machine at the start of a cycle
+ *
+ * @param m Machine to copy
+ * @param freeLog Every register put on the free list of m so far, in order
+ * @param s Receives the snapshot
+ */
+void takeSnapshot(const machine_t *m, const vector<int> &freeLog, machineSnapshot_t *s)
+{
+    s->pushIdx = freeLog.size();
+    s->freeHead = s->pushIdx - m->freeList.size();
+    s->cycle = m->cycle;
+    s->completedInsts = m->completedInsts;
+    s->sinceCommit = m->cycle - m->lastProgress;
+    s->fetchOffset = m->fetchOffset;
+    s->stall = m->stall;
+    s->iqAge = m->iqAge;
+    s->base = m->fetchOffset;
+    memcpy(s->mapTable, m->mapTable, sizeof(s->mapTable));
+    s->readyTable.assign(m->readyTable, m->readyTable + m->pregCount);
+    s->decodeCopies.assign(m->decodeCopies, m->decodeCopies + m->issueWidth);
+
+    s->lanes.clear();
+    for (int i = 0; i < m->issueWidth; i++)
+    {
+        for (int st = 0; st < PIPE_DEPTH; st++)
+            s->lanes.push_back(snapRef(m, m->pipe[i].*laneStages[st]));
+    }
+    s->issueQueue.resize(m->issueQueue.size());
+    for (int i = 0; i < m->issueQueue.size(); i++)
+    {
+        s->issueQueue[i].instr = snapRef(m, m->issueQueue[i].instr);
+        s->issueQueue[i].src1_ready = m->issueQueue[i].src1_ready;
+        s->issueQueue[i].src2_ready = m->issueQueue[i].src2_ready;
+        s->issueQueue[i].age = m->iqAge - m->issueQueue[i].age;
+    }
+    s->wBQueue.clear();
+    for (int i = 0; i < m->wBQueue.size(); i++)
+        s->wBQueue.push_back(snapRef(m, m->wBQueue[i]));
+    s->robPool.resize(m->robPool.size());
+    for (int i = 0; i < m->robPool.size(); i++)
+    {
+        s->robPool[i].instr = snapRef(m, m->robPool[i].instr);
+        s->robPool[i].ready = m->robPool[i].ready;
+        s->robPool[i].committed = m->robPool[i].committed;
+    }
+    s->reorderBuff.clear();
+    int j = 0;
+    for (int i = 0; i < m->reorderBuff.size(); i++)
+    {
+        while (&m->robPool[j] != m->reorderBuff[i])
+            j++;
+        s->reorderBuff.push_back(j);
+    }
+
+    // Records the machine still references can change, all others are final:
+    s->heldIdx.clear();
+    for (int i = 0; i < m->issueWidth; i++)
+    {
+        for (int st = 0; st < 4; st++) // F to Di
+        {
+            if (s->lanes[i * PIPE_DEPTH + st] >= 0)
+                s->heldIdx.push_back(s->lanes[i * PIPE_DEPTH + st]);
+        }
+    }
+    for (int i = 0; i < s->issueQueue.size(); i++)
+        s->heldIdx.push_back(s->issueQueue[i].instr);
+    for (int i = 0; i < s->wBQueue.size(); i++)
+        s->heldIdx.push_back(s->wBQueue[i]);
+    for (int i = 0; i < s->robPool.size(); i++)
+        s->heldIdx.push_back(s->robPool[i].instr);
+    sort(s->heldIdx.begin(), s->heldIdx.end());
+    s->heldIdx.erase(unique(s->heldIdx.begin(), s->heldIdx.end()), s->heldIdx.end());
+    s->held.clear();
+    for (int i = 0; i < s->heldIdx.size(); i++)
+        s->held.push_back(m->instructions[s->heldIdx[i]]);
+    if (!s->heldIdx.empty())
+        s->base = s->heldIdx[0];
+}
+
+/**
+ * @brief Record of an instruction the snapshot holds
+ *
+ * @return const iRecord_t* The record as of the snapshot, NULL if the machine did not reference the instruction
+ */
+const iRecord_t *heldRecord(const machineSnapshot_t *s, unsigned int i)
+{
+    vector<unsigned int>::const_iterator it = lower_bound(s->heldIdx.begin(), s->heldIdx.end(), i);
+    if (it == s->heldIdx.end() || *it != i)
+        return NULL;
+    return &s->held[it - s->heldIdx.begin()];
+}
+
+/**
+ * @brief Puts a machine back into the state of a snapshot
+ *
+ * @param m Machine set up by initMachine() on the trace to continue with
+ * @param s Snapshot to restore
+ * @param final Records at the end of the run the snapshot was taken in, for the records the snapshot does not hold
+ * @param freeLog Free log of the run the snapshot was taken in
+ */
+void restoreSnapshot(machine_t *m, const machineSnapshot_t *s, const iRecord_t *final, const vector<int> &freeLog)
+{
+    memcpy(m->instructions, final, s->fetchOffset * sizeof(iRecord_t));
+    for (int i = 0; i < s->heldIdx.size(); i++)
+        m->instructions[s->heldIdx[i]] = s->held[i];
+    memcpy(m->decodeCopies, s->decodeCopies.data(), m->issueWidth * sizeof(iRecord_t));
+    m->cycle = s->cycle;
+    m->completedInsts = s->completedInsts;
+    m->fetchOffset = s->fetchOffset;
+    m->stall = s->stall;
+    m->iqAge = s->iqAge;
+    m->halted = false;
+    m->haltReason = HALT_NONE;
+    m->lastProgress = s->cycle - s->sinceCommit;
+    m->lastCommitted = s->completedInsts;
+    memcpy(m->mapTable, s->mapTable, sizeof(s->mapTable));
+    memcpy(m->readyTable, s->readyTable.data(), m->pregCount * sizeof(unsigned int));
+    m->freeList.assign(freeLog.begin() + s->freeHead, freeLog.begin() + s->pushIdx);
+
+    for (int i = 0; i < m->issueWidth; i++)
+    {
+        for (int st = 0; st < PIPE_DEPTH; st++)
+            m->pipe[i].*laneStages[st] = unsnapRef(m, s->lanes[i * PIPE_DEPTH + st], 0);
+    }
+    m->issueQueue.resize(s->issueQueue.size());
+    for (int i = 0; i < s->issueQueue.size(); i++)
+    {
+        m->issueQueue[i].instr = unsnapRef(m, s->issueQueue[i].instr, 0);
+        m->issueQueue[i].src1_ready = s->issueQueue[i].src1_ready;
+        m->issueQueue[i].src2_ready = s->issueQueue[i].src2_ready;
+        m->issueQueue[i].age = s->iqAge - s->issueQueue[i].age;
+    }
+    m->wBQueue.clear();
+    for (int i = 0; i < s->wBQueue.size(); i++)
+        m->wBQueue.push_back(unsnapRef(m, s->wBQueue[i], 0));
+    m->commitQueue.clear();
+    m->robPool.resize(s->robPool.size());
+    for (int i = 0; i < s->robPool.size(); i++)
+    {
+        m->robPool[i].instr = unsnapRef(m, s->robPool[i].instr, 0);
+        m->robPool[i].ready = s->robPool[i].ready;
+        m->robPool[i].committed = s->robPool[i].committed;
+    }
+    m->reorderBuff.clear();
+    for (int i = 0; i < s->reorderBuff.size(); i++)
+        m->reorderBuff.push_back(&m->robPool[s->reorderBuff[i]]);
+}
+
+/**
+ * @brief Pairing of the physical registers of a snapshot with those of a machine. Two machines that picked different
+ * registers off their free lists still go on the same way as long as one can be renamed into the other.
+ *
+ */
+typedef struct regMatch_t
+{
+    vector<int> fwd;            //!< Register of the machine for each register of the snapshot, -1 if not paired yet
+    vector<int> inv;            //!< Register of the snapshot for each register of the machine, -1 if not paired yet
+    const vector<int> *lastImm; //!< Last instruction each value turns up in as an immediate, -1 if none
+    int from;                   //!< Oldest instruction still to act. Values used as immediates from here on cannot be renamed
+} regMatch_t;
+
+/**
+ * @brief Pairs a value of the snapshot with a value of the machine
+ *
+ * @return true if the pair is consistent with the pairs so far
+ */
+bool bindReg(regMatch_t *p, int a, int b)
+{
+    int n = p->fwd.size();
+    if (a < 0 || a >= n || b < 0 || b >= n)
+        return a == b;
+    if (((*p->lastImm)[a] >= p->from || (*p->lastImm)[b] >= p->from) && a != b)
+        return false;
+    if (p->fwd[a] == -1 && p->inv[b] == -1)
+    {
+        p->fwd[a] = b;
+        p->inv[b] = a;
+        return true;
+    }
+    return p->fwd[a] == b;
+}
+
+/**
+ * @brief Pairs the renamed registers of a record of the snapshot with those of a record of the machine. Immediates rename
+ * passes through are not registers and have to be equal.
+ *
+ */
+bool bindRecord(regMatch_t *p, const iRecord_t *a, const iRecord_t *b)
+{
+    if (a->iType == 'S' && a->op2_r != b->op2_r)
+        return false;
+    if (a->iType == 'I' && a->op3_r != b->op3_r)
+        return false;
+    return bindReg(p, a->op1_r, b->op1_r) && (a->iType == 'S' || bindReg(p, a->op2_r, b->op2_r)) &&
+           (a->iType == 'I' || bindReg(p, a->op3_r, b->op3_r));
+}
+
+/**
+ * @brief Checks whether a machine is in the state of a snapshot, with every instruction moved by shift and physical
+ * registers paired up. Only what the stages act on is compared: cycle stamps and absolute IQ ages are not. An edit that
+ * changes how many instructions rename leaves the free list longer or shorter for good, since commit gives back a register
+ * for every instruction. So the free list is compared as the sequence rename will take off it until the baseline ends,
+ * the registers on it followed by those commit puts back. The lengths may then differ as long as the list runs dry in
+ * neither run.
+ *
+ * @param m Machine at the start of a cycle
+ * @param s Snapshot to compare against
+ * @param shift Instructions m is ahead of the snapshot by
+ * @param popsLeft Registers the baseline takes off the free list from the snapshot to the end of its run
+ * @param freeLog Registers put on the free list over the baseline run, in order, -1 where not known
+ * @param p Receives the register pairing, lastImm set up by the caller
+ * @return true if m will go on exactly as the snapshot did
+ */
+bool matchesSnapshot(const machine_t *m, const machineSnapshot_t *s, int shift, size_t popsLeft, const vector<int> &freeLog, regMatch_t *p)
+{
+    if (m->fetchOffset != s->fetchOffset + shift || m->completedInsts != s->completedInsts + shift || m->stall != s->stall ||
+        m->issueQueue.size() != s->issueQueue.size() || m->wBQueue.size() != s->wBQueue.size() || m->robPool.size() != s->robPool.size() ||
+        m->reorderBuff.size() != s->reorderBuff.size())
+        return false;
+
+    // Both lists move by the same pops and pushes from here on, so m's stays longer or shorter by the same count:
+    const size_t sLen = s->pushIdx - s->freeHead, mLen = m->freeList.size();
+    if (sLen != mLen && (s->minFree == 0 || (long long)s->minFree + (long long)mLen - (long long)sLen <= 0))
+        return false;
+
+    // Where everything is has to line up before registers are worth pairing:
+    for (int i = 0; i < m->issueWidth; i++)
+    {
+        for (int st = 0; st < 4; st++) // F to Di
+        {
+            if (snapRef(m, m->pipe[i].*laneStages[st]) != shiftRef(s->lanes[i * PIPE_DEPTH + st], shift))
+                return false;
+        }
+        if (!sameInstr(&m->decodeCopies[i], &s->decodeCopies[i]))
+            return false;
+    }
+    for (int i = 0; i < s->issueQueue.size(); i++)
+    {
+        if (snapRef(m, m->issueQueue[i].instr) != shiftRef(s->issueQueue[i].instr, shift) ||
+            m->issueQueue[i].src1_ready != s->issueQueue[i].src1_ready || m->issueQueue[i].src2_ready != s->issueQueue[i].src2_ready ||
+            m->iqAge - m->issueQueue[i].age != s->issueQueue[i].age)
+            return false;
+    }
+    for (int i = 0; i < s->wBQueue.size(); i++)
+        if (snapRef(m, m->wBQueue[i]) != shiftRef(s->wBQueue[i], shift))
+            return false;
+    for (int i = 0; i < s->robPool.size(); i++)
+    {
+        if (snapRef(m, m->robPool[i].instr) != shiftRef(s->robPool[i].instr, shift) || m->robPool[i].ready != s->robPool[i].ready ||
+            m->robPool[i].committed != s->robPool[i].committed)
+            return false;
+    }
+    for (int i = 0; i < s->reorderBuff.size(); i++)
+        if (m->reorderBuff[i] != &m->robPool[s->reorderBuff[i]])
+            return false;
+
+    // Pair up every register the machine still holds:
+    p->fwd.assign(m->pregCount, -1);
+    p->inv.assign(m->pregCount, -1);
+    p->from = s->base;
+    if (!bindReg(p, 0, 0))
+        return false;
+    for (int a = 0; a < AREG_COUNT; a++)
+        if (!bindReg(p, s->mapTable[a], m->mapTable[a]))
+            return false;
+    for (size_t k = 0; k < popsLeft && (k < max(sLen, mLen) || sLen != mLen); k++)
+    {
+        int b = s->freeHead + k < freeLog.size() ? freeLog[s->freeHead + k] : -1;
+        if (k < mLen)
+        {
+            if (!bindReg(p, b, m->freeList[k]))
+                return false;
+        }
+        else if (b < 0 || s->pushIdx + k - mLen >= freeLog.size() || b != freeLog[s->pushIdx + k - mLen]) // Put back by a commit still to come
+            return false;
+    }
+    for (int i = 0; i < m->issueWidth; i++)
+        if (!bindRecord(p, &s->decodeCopies[i], &m->decodeCopies[i]))
+            return false;
+    for (int i = 0; i < s->heldIdx.size(); i++)
+    {
+        const iRecord_t *b = &m->instructions[s->heldIdx[i] + shift];
+        if (!sameInstr(&s->held[i], b) || !bindRecord(p, &s->held[i], b))
+            return false;
+    }
+    for (int r = 0; r < m->pregCount; r++)
+        if (p->fwd[r] != -1 && s->readyTable[r] != m->readyTable[p->fwd[r]])
+            return false;
+    return true;
+}
+
+/**
+ * @brief Simulates a machine to the end, taking a snapshot every few cycles for resimulate() to start from
+ *
+ * @param m Machine to simulate, as set up by initMachine()
+ * @param snaps Receives the snapshots in cycle order
+ * @param freeLog Receives every register put on the free list: the initial list, then those commit puts back, with -1 for
+ * those rename took again the same cycle
+ * @param interval Cycles between snapshots
+ */
+void runBaseline(machine_t *m, vector<machineSnapshot_t> &snaps, vector<int> &freeLog, unsigned int interval)
+{
+    snaps.clear();
+    freeLog.assign(m->freeList.begin(), m->freeList.end());
+    while (!m->halted && m->completedInsts < m->ICOUNT)
+    {
+        if (m->cycle % interval == 0)
+        {
+            snaps.push_back(machineSnapshot_t());
+            takeSnapshot(m, freeLog, &snaps.back());
+            snaps.back().minFree = UINT_MAX;
+        }
+        unsigned int committed = m->completedInsts;
+        runCycles(m, NULL, 1);
+
+        // Commit pushes one register per instruction before rename pops any, so this cycle's are at the back:
+        size_t pushed = m->completedInsts - committed;
+        size_t kept = min(pushed, m->freeList.size());
+        freeLog.insert(freeLog.end(), pushed - kept, -1);
+        freeLog.insert(freeLog.end(), m->freeList.end() - kept, m->freeList.end());
+        if (!snaps.empty())
+            snaps.back().minFree = min(snaps.back().minFree, (unsigned int)m->freeList.size());
+    }
+    for (int k = (int)snaps.size() - 2; k >= 0; k--)
+        snaps[k].minFree = min(snaps[k].minFree, snaps[k + 1].minFree);
+}
+
+/**
+ * @brief Simulates a changed trace by reusing a baseline run of the original. Simulation resumes from the last snapshot
+ * before the first changed instruction and stops as soon as the machine is back in the state of a later baseline snapshot,
+ * with instructions moved by however many were added or removed and physical registers renamed. The records of the rest
+ * of the run are then the baseline's, moved by the same number of cycles.
+ *
+ * @param base Baseline machine at the end of its run
+ * @param snaps Snapshots taken during the baseline run by runBaseline()
+ * @param freeLog Free log of the baseline run from runBaseline()
+ * @param t Changed trace
+ * @param m Receives the records of the changed trace. Its queues are left where simulation stopped
+ * @param r Receives what was reused
+ */
+void resimulate(const machine_t *base, const vector<machineSnapshot_t> &snaps, const vector<int> &freeLog, const trace_t *t, machine_t *m,
+                resimReport_t *r)
+{
+    const iRecord_t *a = base->instructions;
+    const unsigned int aCount = base->ICOUNT;
+    const int shift = (int)t->count - (int)aCount;
+
+    // First instruction that differs, and the first baseline instruction of the unchanged tail:
+    unsigned int first = 0;
+    while (first < aCount && first < t->count && sameInstr(&a[first], &t->instrs[first]))
+        first++;
+    unsigned int tail = aCount;
+    while (tail > 0 && (int)tail + shift > 0 && sameInstr(&a[tail - 1], &t->instrs[tail - 1 + shift]))
+        tail--;
+
+    // Resume from the last snapshot whose past did not see the change:
+    initMachine(m, t, base->issueWidth, base->pregCount);
+    const machineSnapshot_t *from = NULL;
+    for (int k = snaps.size() - 1; k >= 0 && from == NULL; k--)
+    {
+        if (snaps[k].fetchOffset <= first && snaps[k].fetchOffset < aCount && snaps[k].completedInsts < t->count)
+            from = &snaps[k];
+    }
+    if (from != NULL)
+        restoreSnapshot(m, from, a, freeLog);
+    r->firstDiff = first;
+    r->resumeCycle = m->cycle;
+    r->convergeCycle = UINT_MAX;
+    r->simulated = 0;
+
+    // Issue wakes up the IQ with the immediate of a store as if it were a register, those values have to stay put. The
+    // immediate of an I-type only ever wakes up an operand that is ready already:
+    vector<int> lastImm(m->pregCount, -1);
+    for (unsigned int i = 0; i < aCount; i++)
+    {
+        int imm = a[i].iType == 'S' ? a[i].op2 : -1;
+        if (imm >= 0 && imm < m->pregCount)
+            lastImm[imm] = i;
+    }
+    regMatch_t regs;
+    regs.lastImm = &lastImm;
+
+    const machineSnapshot_t *match = NULL;
+    while (!m->halted && m->completedInsts < m->ICOUNT)
+    {
+        // Snapshots are in commit order, only look at the ones that committed as many instructions:
+        long long committed = (long long)m->completedInsts - shift;
+        size_t k = lower_bound(snaps.begin(), snaps.end(), committed,
+                               [](const machineSnapshot_t &s, long long c) { return s.completedInsts < c; }) - snaps.begin();
+        for (; k < snaps.size() && snaps[k].completedInsts == committed && match == NULL; k++)
+        {
+            const machineSnapshot_t *s = &snaps[k];
+            // Reusing the baseline has to stay clear of every budget the baseline did not run into:
+            long long lastStep = (long long)base->cycle - 1 + m->cycle - s->cycle;
+            bool inBudget = (!theBudget.maxCycles || lastStep < theBudget.maxCycles) &&
+                            (!theBudget.maxCommitted || theBudget.maxCommitted >= m->ICOUNT) && m->cycle - m->lastProgress <= s->sinceCommit;
+            size_t popsLeft = s->pushIdx - s->freeHead + (base->completedInsts - s->completedInsts) - base->freeList.size();
+            if (s->cycle > 0 && s->fetchOffset >= tail && !base->halted && inBudget && matchesSnapshot(m, s, shift, popsLeft, freeLog, &regs))
+                match = s;
+        }
+        if (match != NULL)
+            break;
+        runCycles(m, NULL, 1);
+        r->simulated++;
+    }
+    if (match == NULL)
+        return;
+
+    // Stitch on the rest of the baseline. Stamps the baseline wrote after the snapshot move by the cycle offset:
+    int offset = (int)m->cycle - (int)match->cycle;
+    r->convergeCycle = m->cycle;
+    r->convergeSnap = match->cycle;
+    for (unsigned int i = match->base; i < aCount; i++)
+    {
+        const iRecord_t *fin = &a[i];
+        iRecord_t before = *fin; // Records the snapshot does not hold did not change after it
+        if (heldRecord(match, i) != NULL)
+            before = *heldRecord(match, i);
+        else if (i >= match->fetchOffset)
+        {
+            for (int st = 0; st < PIPE_DEPTH; st++)
+                before.*stageStamps[st] = 0;
+            before.fetchIndex = before.op1_r = before.op2_r = before.op3_r = 0; // Not fetched yet, as loaded
+        }
+
+        iRecord_t *out = &m->instructions[i + shift];
+        for (int o = 0; o < 3; o++)
+        {
+            int reg = fin->*renamedOperands[o];
+            if (reg != before.*renamedOperands[o])
+                out->*renamedOperands[o] = reg >= 0 && reg < m->pregCount && regs.fwd[reg] != -1 ? regs.fwd[reg] : reg;
+        }
+        for (int st = 0; st < PIPE_DEPTH; st++)
+        {
+            if (fin->*stageStamps[st] != before.*stageStamps[st])
+                out->*stageStamps[st] = fin->*stageStamps[st] + offset;
+        }
+        if (fin->fetchIndex != before.fetchIndex)
+            out->fetchIndex = fin->fetchIndex + shift;
+    }
+    m->cycle = base->cycle + offset;
+    m->completedInsts = base->completedInsts + shift;
+    m->fetchOffset = base->fetchOffset + shift;
+    m->halted = base->halted;
+}
+
+/**
+ * @brief Attaches to the telemetry block of a simulation running in another process and prints its progress until the
+ * run is over or the process is gone.
+ *
+ * @param name Shared memory object name given to --telemetry
+ * @param intervalMs Milliseconds between lines
+ * @return int 0 once the run is over, 1 if the block could not be read
+ */
+int attachTelemetry(const char *name, unsigned int intervalMs)
+{
+    char path[NAME_MAX];
+    snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name);
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        printf("error: cannot open telemetry block %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    void *p = mmap(NULL, sizeof(telemetry_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        printf("error: cannot map telemetry block %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    const telemetry_t *b = (const telemetry_t *)p;
+    if (b->magic.load(memory_order_acquire) != TELEMETRY_MAGIC)
+    {
+        printf("error: %s is not a telemetry block\n", path);
+        munmap(p, sizeof(telemetry_t));
+        return 1;
+    }
+
+    printf("%10s %12s %12s %6s %6s %6s %7s %12s %9s\n", "cycle", "committed", "of", "ROB", "IQ", "free", "IPC", "instr/s", "seconds");
+    for (;;)
+    {
+        // Retry until the writer was not in the middle of an update:
+        unsigned int before, cycle, committed, count, rob, iq, freeRegs;
+        double ipc, rate, seconds;
+        do
+        {
+            while ((before = b->seq.load(memory_order_acquire)) & 1)
+                this_thread::yield();
+            cycle = b->cycle.load(memory_order_relaxed);
+            committed = b->committed.load(memory_order_relaxed);
+            count = b->ICOUNT.load(memory_order_relaxed);
+            rob = b->robOccupancy.load(memory_order_relaxed);
+            iq = b->iqOccupancy.load(memory_order_relaxed);
+            freeRegs = b->freeRegs.load(memory_order_relaxed);
+            ipc = b->ipc.load(memory_order_relaxed);
+            rate = b->instrsPerSec.load(memory_order_relaxed);
+            seconds = b->seconds.load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+        } while (b->seq.load(memory_order_relaxed) != before);
+        printf("%10u %12u %12u %6u %6u %6u %7.3f %12.0f %9.2f\n", cycle, committed, count, rob, iq, freeRegs, ipc, rate, seconds);
+        fflush(stdout);
+
+        if (!b->running.load(memory_order_acquire))
+        {
+            printf("run over: %s\n", haltNames[b->haltReason.load()]);
+            break;
+        }
+        if (kill(b->pid.load(), 0) < 0 && errno == ESRCH)
+        {
+            printf("run over: simulation process %d is gone\n", b->pid.load());
+            break;
+        }
+        this_thread::sleep_for(chrono::milliseconds(intervalMs));
+    }
+    munmap(p, sizeof(telemetry_t));
+    return 0;
+}
+
+/**
+ * @brief Prints the command line options
+ *
+ * @param prog Name the program was run as
+ */
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [options] [trace] [output]\n", prog);
+    fprintf(stderr, "  --width N         override the issue width in the trace header\n");
+    fprintf(stderr, "  --pregs N         override the physical register count in the trace header\n");
+    fprintf(stderr, "  --fast            extrapolate through loops once they reach a steady state, not with --split\n");
+    fprintf(stderr, "  --fast-check      --fast, then simulate exactly and report the error\n");
+    fprintf(stderr, "  --split           run the front end and back end of the pipeline on separate threads\n");
+    fprintf(stderr, "  --split-check     --split, then simulate on one thread and compare records and run times\n");
+    fprintf(stderr, "  --bounds          print IPC bounds for the trace instead of simulating\n");
+    fprintf(stderr, "  --target-ipc X    with --bounds, exit with status 2 if the configuration cannot reach X\n");
+    fprintf(stderr, "  --bounds-check    simulate every --sweep-width and --sweep-pregs configuration and fail if one beats its bound\n");
+    fprintf(stderr, "  --batch PATH      simulate every trace in a directory or listed in a manifest file\n");
+    fprintf(stderr, "  --batch-out DIR   directory for the per-trace outputs and summary.txt of --batch\n");
+    fprintf(stderr, "  --jobs N          worker threads for --batch\n");
+    fprintf(stderr, "  --explore         find the smallest configurations that reach --target-ipc\n");
+    fprintf(stderr, "  --sweep-width L   comma separated issue widths to explore\n");
+    fprintf(stderr, "  --sweep-pregs L   comma separated physical register counts to explore\n");
+    fprintf(stderr, "  --chunk N         cycles each configuration runs between exploration decisions\n");
+    fprintf(stderr, "  --lockstep-pregs L  simulate comma separated physical register counts from one load, records to output.<pregs>\n");
+    fprintf(stderr, "  --lockstep-check  with --lockstep-pregs, also load and simulate each count on its own and compare\n");
+    fprintf(stderr, "  --baseline FILE   simulate the trace as a change to FILE, reusing the run of FILE where they agree\n");
+    fprintf(stderr, "  --snapshot-every N  cycles between the baseline snapshots of --baseline\n");
+    fprintf(stderr, "  --resim-check     with --baseline, also simulate the trace from scratch and compare\n");
+    fprintf(stderr, "  --max-cycles N    stop a machine after cycle N, 0 for no limit (default none)\n");
+    fprintf(stderr, "  --max-committed N stop a machine once N instructions have committed\n");
+    fprintf(stderr, "  --max-seconds S   stop a machine after simulating for S seconds of wall clock time\n");
+    fprintf(stderr, "  --watchdog N      stop a machine after N cycles without a commit, 0 for never (default %u)\n", WATCHDOG_CYCLES);
+    fprintf(stderr, "  --telemetry NAME  publish run statistics in shared memory object NAME\n");
+    fprintf(stderr, "  --telemetry-every N  cycles between telemetry updates\n");
+    fprintf(stderr, "  --pipeview FILE   stream stage transitions of committed instructions to FILE in O3PipeView format\n");
+    fprintf(stderr, "  --pipeview-range A-B  only export instructions A to B-1, or from A on for A\n");
+    fprintf(stderr, "  --pipeview-sample N,K  only export the first K instructions of every N\n");
+    fprintf(stderr, "  --profile         time each stage function and read hardware counters around it where available\n");
+    fprintf(stderr, "  --attach NAME     print the statistics a run publishes in NAME until it ends\n");
+    fprintf(stderr, "  --interval MS     milliseconds between the lines of --attach\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *inFile = "test.in";  //!< Trace to simulate
+    const char *outFile = "out.txt"; //!< File to write the per-instruction records to
+    bool fastMode = false;           //!< Extrapolate through loops once they reach a steady state
+    bool fastCheck = false;          //!< Also simulate exactly and report the fast mode error
+    bool split = false;              //!< Run the pipeline on two threads
+    bool splitCheck = false;         //!< Also run on one thread and compare
+    bool boundsOnly = false;         //!< Print IPC bounds instead of simulating
+    bool boundsCheck = false;        //!< Hold the sweep configurations to their IPC bounds
+    double targetIpc = 0.0;          //!< IPC the configuration has to be able to reach, 0 for none
+    int widthOverride = -1;          //!< Issue width to use instead of the trace header's
+    int pregOverride = -1;           //!< Physical register count to use instead of the trace header's
+    const char *batchSource = NULL;  //!< Directory or manifest of traces to run as a batch
+    const char *batchOut = "batch_out"; //!< Directory for the batch outputs
+    unsigned int jobs = max(1u, thread::hardware_concurrency()); //!< Batch worker threads
+    bool explore = false;            //!< Run a design space exploration instead of one configuration
+    vector<unsigned int> sweepWidths = {1, 2, 4, 8};              //!< Widths to explore
+    vector<unsigned int> sweepPregs = {33, 40, 48, 64, 96, 128}; //!< Physical register counts to explore
+    unsigned int chunkCycles = DSE_CHUNK_CYCLES;                  //!< Cycles per exploration slice
+    vector<unsigned int> lockstepPregs;                           //!< Physical register counts to simulate from one load
+    bool lockstepCheck = false;                                   //!< Also simulate each lockstep configuration on its own
+    const char *baselineFile = NULL;                              //!< Trace the simulated trace is a change of
+    unsigned int snapshotCycles = RESIM_SNAPSHOT_CYCLES;          //!< Cycles between baseline snapshots
+    bool resimCheck = false;                                      //!< Also simulate the changed trace from scratch
+    const char *telemetryName = NULL;                             //!< Shared memory object to publish run statistics in
+    unsigned int telemetryCycles = TELEMETRY_CYCLES;              //!< Cycles between telemetry updates
+    const char *attachName = NULL;                                //!< Telemetry block of another run to print
+    unsigned int attachMs = 1000;                                 //!< Milliseconds between the lines of --attach
+    telemetryWriter_t telemetry;                                  //!< Writer for --telemetry
+    const char *pipeViewFile = NULL;                              //!< File to stream the pipeline view to
+    pipeView_t pipeView = {NULL, 0, UINT_MAX, 0, 0, 0, 0};        //!< Export for --pipeview, with its sampling window
+    bool profile = false;                                         //!< Profile the stage functions
+    stageProfile_t stageProfile;                                  //!< Profile for --profile
+    int positional = 0;
+    machine_t theMachine; //!< The simulated machine
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--fast") == 0)
+            fastMode = true;
+        else if (strcmp(argv[i], "--fast-check") == 0)
+            fastMode = fastCheck = true;
+        else if (strcmp(argv[i], "--split") == 0)
+            split = true;
+        else if (strcmp(argv[i], "--split-check") == 0)
+            split = splitCheck = true;
+        else if (strcmp(argv[i], "--bounds") == 0)
+            boundsOnly = true;
+        else if (strcmp(argv[i], "--bounds-check") == 0)
+            boundsCheck = true;
+        else if (strcmp(argv[i], "--target-ipc") == 0 && i + 1 < argc)
+            targetIpc = atof(argv[++i]);
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            batchSource = argv[++i];
+        else if (strcmp(argv[i], "--batch-out") == 0 && i + 1 < argc)
+            batchOut = argv[++i];
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+            jobs = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--explore") == 0)
+            explore = true;
+        else if (strcmp(argv[i], "--sweep-width") == 0 && i + 1 < argc)
+            parseList(argv[++i], sweepWidths);
+        else if (strcmp(argv[i], "--sweep-pregs") == 0 && i + 1 < argc)
+            parseList(argv[++i], sweepPregs);
+        else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc)
+            chunkCycles = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--lockstep-pregs") == 0 && i + 1 < argc)
+            parseList(argv[++i], lockstepPregs);
+        else if (strcmp(argv[i], "--lockstep-check") == 0)
+            lockstepCheck = true;
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baselineFile = argv[++i];
+        else if (strcmp(argv[i], "--snapshot-every") == 0 && i + 1 < argc)
+            snapshotCycles = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--resim-check") == 0)
+            resimCheck = true;
+        else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc)
+            theBudget.maxCycles = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--max-committed") == 0 && i + 1 < argc)
+            theBudget.maxCommitted = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--max-seconds") == 0 && i + 1 < argc)
+            theBudget.maxSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--watchdog") == 0 && i + 1 < argc)
+            theBudget.stallCycles = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc)
+            telemetryName = argv[++i];
+        else if (strcmp(argv[i], "--telemetry-every") == 0 && i + 1 < argc)
+            telemetryCycles = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--pipeview") == 0 && i + 1 < argc)
+            pipeViewFile = argv[++i];
+        else if (strcmp(argv[i], "--pipeview-range") == 0 && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%u-%u", &pipeView.first, &pipeView.last) < 1)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--pipeview-sample") == 0 && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%u,%u", &pipeView.period, &pipeView.count) != 2 || pipeView.count == 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--profile") == 0)
+            profile = true;
+        else if (strcmp(argv[i], "--attach") == 0 && i + 1 < argc)
+            attachName = argv[++i];
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+            attachMs = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+            widthOverride = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--pregs") == 0 && i + 1 < argc)
+            pregOverride = atoi(argv[++i]);
+        else if (argv[i][0] == '-')
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else if (positional++ == 0)
+            inFile = argv[i];
+        else
+            outFile = argv[i];
+    }
+
+    if (attachName != NULL)
+        return attachTelemetry(attachName, attachMs);
+    if (batchSource != NULL)
+        return runBatch(batchSource, batchOut, jobs, widthOverride, pregOverride, fastMode) == 0 ? 0 : 1;
+
+    chrono::steady_clock::time_point loadStart = chrono::steady_clock::now();
+    if (loadTrace(inFile, &theTrace) < 0)
+        return 1;
+    double loadSec = chrono::duration<double>(chrono::steady_clock::now() - loadStart).count();
+    ISSUE_WIDTH = theTrace.issueWidth;
+    PREG_COUNT = theTrace.pregCount;
+    if (widthOverride >= 0)
+        ISSUE_WIDTH = widthOverride;
+    if (pregOverride >= 0)
+        PREG_COUNT = pregOverride;
+
+    if (boundsCheck)
+    {
+        int violations = checkBounds(&theTrace, sweepWidths, sweepPregs);
+        freeTrace(&theTrace);
+        return violations ? 1 : 0;
+    }
+
+    if (explore)
+    {
+        if (targetIpc <= 0.0)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        int violations = exploreDesignSpace(sweepWidths, sweepPregs, targetIpc, chunkCycles);
+        freeTrace(&theTrace);
+        return violations ? 1 : 0;
+    }
+
+    if (!lockstepPregs.empty())
+    {
+        int mismatches = runLockstep(&theTrace, ISSUE_WIDTH, lockstepPregs, inFile, loadSec, outFile, lockstepCheck);
+        freeTrace(&theTrace);
+        return mismatches ? 1 : 0;
+    }
+
+    if (baselineFile != NULL)
+    {
+        trace_t baseTrace = {NULL, 0, 0, 0, 0};
+        machine_t baseMachine;
+        vector<machineSnapshot_t> snaps;
+        vector<int> freeLog;
+        resimReport_t report;
+        if (loadTrace(baselineFile, &baseTrace) < 0)
+            return 1;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        initMachine(&baseMachine, &baseTrace, ISSUE_WIDTH, PREG_COUNT);
+        runBaseline(&baseMachine, snaps, freeLog, snapshotCycles);
+        double baseSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        resimulate(&baseMachine, snaps, freeLog, &theTrace, &theMachine, &report);
+        double resimSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        printRecords(&theMachine, outFile);
+
+        printf("Baseline %s: %u cycles, %lu snapshots, %.3f s\n", baselineFile, baseMachine.cycle, snaps.size(), baseSec);
+        if (report.firstDiff == theTrace.count && report.firstDiff == baseTrace.count)
+            printf("Changed trace: same instructions as the baseline, resumed from cycle %u\n", report.resumeCycle);
+        else
+            printf("Changed trace: first difference at instruction %u, resumed from cycle %u\n", report.firstDiff, report.resumeCycle);
+        if (report.convergeCycle != UINT_MAX)
+            printf("  matched baseline cycle %u at cycle %u, reused the rest of the baseline\n", report.convergeSnap, report.convergeCycle);
+        else
+            printf("  never matched the baseline again\n");
+        printf("  simulated %u cycles, run ended at cycle %u, %.3f s\n", report.simulated, theMachine.cycle, resimSec);
+
+        int diffs = 0;
+        if (resimCheck)
+        {
+            machine_t fullMachine;
+            start = chrono::steady_clock::now();
+            initMachine(&fullMachine, &theTrace, ISSUE_WIDTH, PREG_COUNT);
+            runMachine(&fullMachine, NULL);
+            double fullSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            diffs = compareMachines(&fullMachine, &theMachine);
+            if (fullMachine.cycle != theMachine.cycle)
+                diffs++;
+            printf("  from scratch: %u cycles, %.3f s, %s\n", fullMachine.cycle, fullSec, diffs ? "MISMATCH" : "exact");
+            freeMachine(&fullMachine);
+        }
+        freeMachine(&baseMachine);
+        freeMachine(&theMachine);
+        freeTrace(&baseTrace);
+        freeTrace(&theTrace);
+        return diffs ? 1 : 0;
+    }
+
+    if (boundsOnly)
+    {
+        unsigned int icount = theTrace.count;
+        printBounds(icount, ISSUE_WIDTH, PREG_COUNT);
+        freeTrace(&theTrace);
+
+        if (targetIpc > 0.0 && ipcBound(icount, ISSUE_WIDTH, PREG_COUNT) < targetIpc)
+        {
+            printf("prune: width %u, %u pregs cannot reach IPC %.3f\n", ISSUE_WIDTH, PREG_COUNT, targetIpc);
+            return 2;
+        }
+        return 0;
+    }
+
+    if (fastMode && split) // Steady states are looked for by runMachine(), which the split engine does not go through
+    {
+        fprintf(stderr, "--fast covers the single-thread engine, not --split\n");
+        freeTrace(&theTrace);
+        return 1;
+    }
+
+    fastForward_t ff;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    initMachine(&theMachine, &theTrace, ISSUE_WIDTH, PREG_COUNT);
+    if (telemetryName != NULL)
+    {
+        if (openTelemetry(&telemetry, telemetryName, telemetryCycles) < 0)
+            return 1;
+        theMachine.telemetry = &telemetry;
+        publishTelemetry(&theMachine); // Readers attaching before the first update see the run's size and queues
+    }
+    if (pipeViewFile != NULL)
+    {
+        if (openPipeView(&pipeView, pipeViewFile) < 0)
+            return 1;
+        theMachine.pipeView = &pipeView;
+    }
+    if (profile)
+    {
+        if (split) // Both threads of the split engine would charge the one profile at once
+        {
+            fprintf(stderr, "--profile covers the single-thread engine, not --split\n");
+            return 1;
+        }
+        openProfile(&stageProfile);
+        theMachine.profile = &stageProfile;
+    }
+    if (split)
+        runSplit(&theMachine);
+    else
+        runMachine(&theMachine, fastMode ? &ff : NULL);
+    double runSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (theMachine.telemetry != NULL)
+        closeTelemetry(&theMachine);
+    if (theMachine.pipeView != NULL)
+    {
+        closePipeView(&theMachine);
+        printf("Pipeline view: %llu instructions to %s\n", pipeView.written, pipeViewFile);
+    }
+    if (theMachine.profile != NULL)
+    {
+        closeProfile(&stageProfile);
+        theMachine.profile = NULL;
+    }
+    if (theMachine.haltReason != HALT_NONE)
+        fprintf(stderr, "stopped at cycle %u with %u of %u committed: %s\n", theMachine.cycle, theMachine.completedInsts,
+                theMachine.ICOUNT, haltNames[theMachine.haltReason]);
+    printRecords(&theMachine, outFile);
+
+    if (fastCheck)
+    {
+        machine_t exactMachine;
+        start = chrono::steady_clock::now();
+        initMachine(&exactMachine, &theTrace, ISSUE_WIDTH, PREG_COUNT);
+        runMachine(&exactMachine, NULL);
+        double exactSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        fastModeReport(&exactMachine, &theMachine, &ff, exactSec, runSec);
+        freeMachine(&exactMachine);
+    }
+    if (splitCheck)
+    {
+        machine_t serialMachine;
+        start = chrono::steady_clock::now();
+        initMachine(&serialMachine, &theTrace, ISSUE_WIDTH, PREG_COUNT);
+        runMachine(&serialMachine, NULL);
+        double serialSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        unsigned int diffs = compareMachines(&serialMachine, &theMachine);
+        printf("Split engine: %u cycles, %s\n", theMachine.cycle, diffs ? "NOT cycle-exact" : "cycle-exact");
+        if (diffs)
+            printf("  %u of %u records differ\n", diffs, theMachine.ICOUNT);
+        printf("  serial: %.3f s\n  split:  %.3f s (%.2fx)\n", serialSec, runSec, runSec > 0.0 ? serialSec / runSec : 0.0);
+        freeMachine(&serialMachine);
+        if (diffs)
+            return 1;
+    }
 
     // Housekeping for the instructions:
-    free(thePipelineState);
-
-    // for (int i = 0; i < ISSUE_WIDTH; i++)
-    // {
-    //     free(thePipelineState[i].F);
-    //     free(thePipelineState[i].Dc);
-    //     free(thePipelineState[i].R);
-    //     free(thePipelineState[i].Di);
-    //     free(thePipelineState[i].IS);
-    //     free(thePipelineState[i].W);
-    //     free(thePipelineState[i].C);
-    // }
+    freeMachine(&theMachine);
+    freeTrace(&theTrace);
 
     return 0;
 }